@@ -0,0 +1,269 @@
+#include <stdio.h> /* fprintf(), printf(), sprintf(), stderr */
+#include <stdlib.h> /* atoi(), atof(), EXIT_FAILURE, EXIT_SUCCESS, free(), malloc(), realloc(), NULL */
+#include <string.h> /* memcpy(), strcmp(), strlen() */
+#include <time.h> /* clock(), clock_t, CLOCKS_PER_SEC */
+
+#define HOXML_IMPLEMENTATION
+#include "hoxml.h"
+
+#define DEFAULT_MEGABYTES 8 /* Approximate size of each generated corpus */
+#define INITIAL_BUFFER_LENGTH 64 /* Small so the buffer grows, by doubling, to about what each corpus needs */
+#define MINIMUM_SECONDS 0.25 /* Each corpus is parsed repeatedly for at least this long to steady the results */
+#define NUM_CHUNK_LENGTHS 4
+
+/* A generated XML document, grown as it's written */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} corpus_t;
+
+/* Writes elements into the corpus until it reaches the target length. The root element is written around them. */
+typedef void (*generate_t)(corpus_t* corpus, size_t target_length);
+
+typedef struct {
+    const char* name;
+    generate_t generate;
+    int is_utf16; /* Whether the corpus is converted to UTF-16LE once generated */
+} shape_t;
+
+static unsigned long random_state = 1;
+
+/* A small, deterministic pseudorandom number generator so corpora are identical from one run to the next */
+static unsigned long next_random(void) {
+    random_state = random_state * 1103515245UL + 12345UL;
+    return (random_state / 65536UL) % 32768UL;
+}
+
+static void append_bytes(corpus_t* corpus, const char* bytes, size_t length) {
+    if (corpus->length + length + 1 > corpus->capacity) {
+        while (corpus->length + length + 1 > corpus->capacity)
+            corpus->capacity = corpus->capacity == 0 ? 4096 : corpus->capacity * 2;
+        corpus->data = (char*)realloc(corpus->data, corpus->capacity);
+        if (corpus->data == NULL) {
+            fprintf(stderr, "Couldn't allocate %lu bytes for a corpus\n", (unsigned long)corpus->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(corpus->data + corpus->length, bytes, length);
+    corpus->length += length;
+    corpus->data[corpus->length] = '\0';
+}
+
+static void append(corpus_t* corpus, const char* str) {
+    append_bytes(corpus, str, strlen(str));
+}
+
+/* Deeply nested elements, each with a little content, much like a nested configuration or an AST dump */
+static void generate_nested(corpus_t* corpus, size_t target_length) {
+    char line[128];
+    int depth, i;
+
+    while (corpus->length < target_length) {
+        depth = 8 + (int)(next_random() % 56);
+        for (i = 0; i < depth; i++) {
+            sprintf(line, "<node level=\"%d\">", i);
+            append(corpus, line);
+        }
+        append(corpus, "leaf");
+        for (i = depth - 1; i >= 0; i--)
+            append(corpus, i % 4 == 0 ? "</node>\n" : "</node>");
+    }
+}
+
+/* Many empty elements that hold their data in attributes, much like the objects and tiles of a TMX map */
+static void generate_attributes(corpus_t* corpus, size_t target_length) {
+    char line[256];
+    unsigned long id = 0;
+
+    while (corpus->length < target_length) {
+        sprintf(line, "  <object id=\"%lu\" name=\"object %lu\" type=\"npc\" x=\"%lu\" y=\"%lu\" width=\"16\" "
+            "height=\"16\" rotation=\"%lu\" visible='1'/>\n", id, id, next_random() % 4096, next_random() % 4096,
+            next_random() % 360);
+        append(corpus, line);
+        id++;
+    }
+}
+
+/* Long runs of character data with few tags, much like a book or an article */
+static void generate_text(corpus_t* corpus, size_t target_length) {
+    static const char* words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+        "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua" };
+    int i, count;
+
+    while (corpus->length < target_length) {
+        append(corpus, "  <paragraph>");
+        count = 100 + (int)(next_random() % 200);
+        for (i = 0; i < count; i++) {
+            append(corpus, words[next_random() % (sizeof(words) / sizeof(words[0]))]);
+            append(corpus, i % 16 == 15 ? ".\n    " : " ");
+        }
+        append(corpus, "</paragraph>\n");
+    }
+}
+
+/* Text where entity and character references are frequent, much like escaped markup or non-ASCII text in ASCII */
+static void generate_references(corpus_t* corpus, size_t target_length) {
+    static const char* references[] = { "&amp;", "&lt;", "&gt;", "&quot;", "&apos;", "&#233;", "&#x4E2D;",
+        "&#8364;" };
+    int i;
+
+    while (corpus->length < target_length) {
+        append(corpus, "  <escaped value=\"a &lt; b &amp;&amp; c &gt; d\">");
+        for (i = 0; i < 32; i++) {
+            append(corpus, "text");
+            append(corpus, references[next_random() % (sizeof(references) / sizeof(references[0]))]);
+        }
+        append(corpus, "</escaped>\n");
+    }
+}
+
+/* CDATA sections holding code, much like scripts or styles embedded in a document */
+static void generate_cdata(corpus_t* corpus, size_t target_length) {
+    int i, count;
+
+    while (corpus->length < target_length) {
+        append(corpus, "  <script><![CDATA[\n");
+        count = 10 + (int)(next_random() % 30);
+        for (i = 0; i < count; i++)
+            append(corpus, "    if (a < b && b > c) { x[y[0]] = \"<tag>\"; }\n");
+        append(corpus, "  ]]></script>\n");
+    }
+}
+
+/* Convert a corpus, written as UTF-8, to UTF-16LE with its byte order mark */
+static void convert_to_utf16(corpus_t* corpus) {
+    corpus_t converted;
+    const char* it;
+
+    converted.data = NULL;
+    converted.length = converted.capacity = 0;
+    append_bytes(&converted, "\xFF\xFE", 2);
+    for (it = corpus->data; it < corpus->data + corpus->length;) {
+        hoxml_character_t c = hoxml_decode_character(it, corpus->data + corpus->length - it, HOXML_ENC_UTF_8);
+        hoxml_character_t e = hoxml_encode_character(c.codepoint, HOXML_ENC_UTF_16_LE);
+
+        append_bytes(&converted, (const char*)&(e.encoded), e.bytes);
+        it += c.bytes;
+    }
+    free(corpus->data);
+    *corpus = converted;
+}
+
+static void generate(corpus_t* corpus, const shape_t* shape, size_t target_length) {
+    corpus->data = NULL;
+    corpus->length = corpus->capacity = 0;
+    random_state = 1;
+    append(corpus, "<?xml version=\"1.0\"?>\n<corpus>\n");
+    shape->generate(corpus, target_length);
+    append(corpus, "</corpus>\n");
+    if (shape->is_utf16)
+        convert_to_utf16(corpus);
+}
+
+/* Parse the whole corpus, passing it in chunks of the given length (or all at once if zero), and count the codes */
+/* returned. Returns the final code, HOXML_END_OF_DOCUMENT unless something went wrong. */
+static hoxml_code_t parse(const corpus_t* corpus, size_t chunk_length, int options, unsigned long* code_count,
+        size_t* buffer_length) {
+    hoxml_context_t context;
+    hoxml_code_t code;
+    size_t position, length;
+    void* buffer;
+
+    *buffer_length = INITIAL_BUFFER_LENGTH;
+    buffer = malloc(*buffer_length);
+    hoxml_init(&context, buffer, *buffer_length);
+    context.options = options;
+    *code_count = 0;
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    if (chunk_length == 0)
+        chunk_length = corpus->length;
+    for (position = 0; position < corpus->length && code == HOXML_ERROR_UNEXPECTED_EOF; position += length) {
+        length = corpus->length - position < chunk_length ? corpus->length - position : chunk_length;
+        for (;;) {
+            code = hoxml_parse(&context, corpus->data + position, length);
+            if (code == HOXML_ERROR_INSUFFICIENT_MEMORY) {
+                void* new_buffer = malloc(*buffer_length * 2);
+
+                hoxml_realloc(&context, new_buffer, *buffer_length * 2);
+                free(buffer);
+                buffer = new_buffer;
+                *buffer_length *= 2;
+            } else if (code > HOXML_END_OF_DOCUMENT)
+                (*code_count)++;
+            else
+                break;
+        }
+    }
+    free(buffer);
+    return code;
+}
+
+int main(int argc, char** argv) {
+    static const shape_t shapes[] = {
+        { "nested", generate_nested, 0 },
+        { "attributes", generate_attributes, 0 },
+        { "text", generate_text, 0 },
+        { "references", generate_references, 0 },
+        { "cdata", generate_cdata, 0 },
+        { "attributes-utf16", generate_attributes, 1 },
+        { "text-utf16", generate_text, 1 }
+    };
+    static const size_t chunk_lengths[NUM_CHUNK_LENGTHS] = { 0, 65536, 4096, 75 };
+    double megabytes;
+    const char* only_shape;
+    int options;
+    size_t shape_index, chunk_index;
+
+    /* Usage: hoxml-bench [megabytes [shape [options]]] where options is a sum of hoxml_option_t values */
+    megabytes = argc > 1 ? atof(argv[1]) : DEFAULT_MEGABYTES;
+    only_shape = argc > 2 && strcmp(argv[2], "all") != 0 ? argv[2] : NULL;
+    options = argc > 3 ? atoi(argv[3]) : 0;
+    if (megabytes <= 0.0) {
+        fprintf(stderr, "Usage: %s [megabytes [shape|all [options]]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-18s %8s %10s %10s %12s %10s\n", "shape", "chunk", "size (MB)", "MB/s", "codes/s", "buffer");
+    for (shape_index = 0; shape_index < sizeof(shapes) / sizeof(shapes[0]); shape_index++) {
+        corpus_t corpus;
+
+        if (only_shape != NULL && strcmp(only_shape, shapes[shape_index].name) != 0)
+            continue;
+        generate(&corpus, &(shapes[shape_index]), (size_t)(megabytes * 1000000.0));
+        for (chunk_index = 0; chunk_index < NUM_CHUNK_LENGTHS; chunk_index++) {
+            unsigned long code_count;
+            size_t buffer_length;
+            hoxml_code_t code;
+            clock_t start;
+            double seconds;
+            int runs;
+            char chunk[24];
+
+            /* Parse repeatedly until enough time has passed to average out the clock's resolution */
+            runs = 0;
+            start = clock();
+            do {
+                code = parse(&corpus, chunk_lengths[chunk_index], options, &code_count, &buffer_length);
+                runs++;
+                seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+            } while (code == HOXML_END_OF_DOCUMENT && seconds < MINIMUM_SECONDS);
+            if (code != HOXML_END_OF_DOCUMENT) {
+                fprintf(stderr, "Parsing the \"%s\" corpus failed with code %d\n", shapes[shape_index].name, code);
+                free(corpus.data);
+                return EXIT_FAILURE;
+            }
+
+            if (chunk_lengths[chunk_index] == 0)
+                sprintf(chunk, "whole");
+            else
+                sprintf(chunk, "%lu", (unsigned long)chunk_lengths[chunk_index]);
+            printf("%-18s %8s %10.2f %10.1f %12.0f %10lu\n", shapes[shape_index].name, chunk,
+                corpus.length / 1000000.0, corpus.length * runs / 1000000.0 / seconds, code_count * runs / seconds,
+                (unsigned long)buffer_length);
+        }
+        free(corpus.data);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -25,13 +25,36 @@ OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
     #define HOXML_DECL extern
   to specify hoxml function declarations as static or extern, respectively.
   The default specifier is extern.
+
+  You can also
+    #define HOXML_ENABLE_FILE
+  before including this file to add the hoxml_file_*() functions that parse a whole file from disk, mapping it to
+  memory where supported.
+
+  Similarly,
+    #define HOXML_ENABLE_INDEX
+  adds the hoxml_index_*() functions that parse a whole document once into an index that can be read repeatedly.
+  Both require malloc().
 */
 
 #ifndef HOXML_H
     #define HOXML_H
 
-#include <stdlib.h> /* strtoul() */
-#include <string.h> /* memcpy(), memset(), NULL, size_t */
+/* With strict standard modes (e.g. -ansi or -std=c99), POSIX systems only declare what the standard does unless */
+/* asked for more. Files are mapped, and how they're read is hinted, with POSIX functions. Asking must come before */
+/* the first system header is included, this file's or any other. */
+#if defined(HOXML_IMPLEMENTATION) && defined(HOXML_ENABLE_FILE) && defined(__STRICT_ANSI__) && \
+        !defined(_POSIX_C_SOURCE) && !defined(_WIN32)
+    #define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <errno.h> /* errno, ERANGE */
+#include <float.h> /* FLT_MAX */
+#include <limits.h> /* INT_MAX, INT_MIN, LONG_MAX, LONG_MIN, UINT_MAX, ULONG_MAX */
+#include <locale.h> /* localeconv() */
+#include <stddef.h> /* offsetof() */
+#include <stdlib.h> /* free(), malloc(), realloc(), strtod() */
+#include <string.h> /* memchr(), memcmp(), memcpy(), memmove(), memset(), NULL, size_t, strchr(), strcmp(), strlen() */
 
 #ifndef HOXML_DECL
     #define HOXML_DECL
@@ -62,9 +85,110 @@ typedef enum {
     HOXML_ELEMENT_END, /**< An element was closed, </tag> or <tag/>, and its name and content are available. */
     HOXML_ATTRIBUTE, /**< An attribute's value, its name, and its element are available. */
     HOXML_PROCESSING_INSTRUCTION_BEGIN, /**< A processing instruction began and its target is available. */
-    HOXML_PROCESSING_INSTRUCTION_END /**< A processing instruction ended and its content is available. */
+    HOXML_PROCESSING_INSTRUCTION_END, /**< A processing instruction ended and its content is available. */
+    HOXML_TEXT, /**< With HOXML_OPTION_TEXT, a part of the current element's content is available. */
+    HOXML_YIELD /**< hoxml_parse_budget() parsed as many bytes as allowed. Nothing new is available. */
 } hoxml_code_t;
 
+/**
+ * Options that change how hoxml presents what it parsed. Combine them with bitwise OR and assign them to the context
+ * object's 'options' variable after calling hoxml_init() and before the first call to hoxml_parse().
+ */
+typedef enum {
+    HOXML_OPTION_VIEWS = 1, /**< Present strings as views into the XML content, copying them only when necessary. */
+    HOXML_OPTION_TEXT = 2, /**< Return element content in parts with HOXML_TEXT rather than with HOXML_ELEMENT_END. */
+    HOXML_OPTION_UTF_8 = 4, /**< Present all strings encoded with UTF-8, transcoding them if the content is UTF-16. */
+    HOXML_OPTION_FRAGMENT = 8, /**< Parse an element's content, like a part found by hoxml_split(), not a document. */
+    HOXML_OPTION_LAZY_POSITION = 16, /**< Find the line and column only on errors or by calling hoxml_position(). */
+    HOXML_OPTION_STREAM = 32 /**< Parse documents one after another, each following the end of the one before. */
+} hoxml_option_t;
+
+/**
+ * A string that is not necessarily null terminated. It may point into the XML content or into hoxml's buffer.
+ */
+typedef struct {
+    const char* data; /**< Pointer to the first byte of the string, or NULL if there is no string. */
+    size_t length; /**< Length of the string in bytes. */
+} hoxml_view_t;
+
+/**
+ * Maps a fixed set of tag and attribute names to integer IDs, their indices in the 'names' array. Set it up with
+ * hoxml_symbols_init() and assign it to a context object's 'symbols' variable to look names up as they're parsed.
+ */
+typedef struct {
+    /* Public */
+    const char* const* names; /**< The names, encoded with UTF-8 or ASCII, whatever the documents' encoding. */
+    size_t name_count; /**< Number of names. */
+
+    /* Private (for internal use) */
+    int* slots; /* Hash table of indices into 'names', -1 where empty */
+    size_t slot_count; /* Number of slots, a power of two */
+} hoxml_symbols_t;
+
+/**
+ * Types of the fields that attribute values can be bound to with hoxml_bind_attribute().
+ */
+typedef enum {
+    HOXML_BIND_INT, /**< An int holding a decimal integer (e.g. "-42"). */
+    HOXML_BIND_UNSIGNED, /**< An unsigned int holding a non-negative decimal integer (e.g. "42"). */
+    HOXML_BIND_LONG, /**< A long holding a decimal integer. */
+    HOXML_BIND_UNSIGNED_LONG, /**< An unsigned long holding a non-negative decimal integer. */
+    HOXML_BIND_DOUBLE, /**< A double holding a decimal number (e.g. "0.25" or "1e-3"). */
+    HOXML_BIND_FLOAT, /**< A float holding a decimal number. */
+    HOXML_BIND_BOOL, /**< An int holding 1 for "true" or "1" and 0 for "false" or "0". */
+    HOXML_BIND_ENUM /**< An int holding the index of the value in the binding's 'values' symbol table. */
+} hoxml_bind_type_t;
+
+/**
+ * Binds an attribute, by the IDs of its element's and its own name in a symbol table, to a field of a structure.
+ */
+typedef struct {
+    int tag_id; /**< ID of the element's name, or -1 to bind the attribute in any element. */
+    int attribute_id; /**< ID of the attribute's name. */
+    int type; /**< One of the types defined in hoxml_bind_type_t. */
+    size_t offset; /**< Offset of the field in the structure, in bytes, as given by offsetof(). */
+    const hoxml_symbols_t* values; /**< With HOXML_BIND_ENUM, the acceptable values. Otherwise unused. */
+} hoxml_binding_t;
+
+/**
+ * Formats of element content that a decoder can decode into an array of integers.
+ */
+typedef enum {
+    HOXML_DATA_CSV = 1, /**< Decimal integers separated by commas and any whitespace (e.g. "1,2,\n3"). */
+    HOXML_DATA_BASE64 /**< Base64 of 32-bit, little-endian integers, uncompressed, like a TMX map's layer data. */
+} hoxml_data_format_t;
+
+/**
+ * Decodes a large run of integers in element content, like a TMX map's tile data, into an array. Set it up with
+ * hoxml_decoder_init() and pass it content with hoxml_decoder_decode(), all at once or in parts.
+ */
+typedef struct {
+    /* Public */
+    unsigned long* values; /**< Array that receives the integers. Each is in the [0, 0xFFFFFFFF] range. */
+    size_t max_values; /**< Length of the 'values' array. */
+    size_t value_count; /**< Number of integers decoded into the 'values' array so far. */
+
+    /* Private (for internal use) */
+    int format; /* One of the formats defined in hoxml_data_format_t */
+    int is_error; /* Set once the data is found to be malformed, or too long for the array, after which it's ignored */
+    unsigned long value; /* Integer being decoded, from a CSV field's digits or base64's bytes */
+    int value_length; /* Number of digits, or bytes, in the integer being decoded */
+    int is_separated; /* CSV: whether a comma is waiting to be followed by an integer */
+    int is_ended; /* CSV: whether whitespace has followed the integer's digits. Base64: whether padding was found. */
+    unsigned long bits; /* Base64: bits decoded, six per character, and not yet made into bytes */
+    int bit_count; /* Base64: number of those bits */
+    int padding; /* Base64: number of '=' characters still expected once the first is found */
+} hoxml_decoder_t;
+
+/**
+ * Functions that allocate and free blocks of memory for a context object set up with hoxml_init_ex().
+ */
+typedef struct {
+    void* (*allocate)(size_t size, void* user); /**< Allocates a block of memory, like malloc(), or returns NULL. */
+    void (*release)(void* memory, void* user); /**< Frees a block of memory returned by 'allocate', like free(). */
+    void* user; /**< Passed to both functions as their last parameter. */
+} hoxml_allocator_t;
+
 /**
  * Holds context and state information needed by hoxml. Some of this information is public and holds the data parsed
  * from XML content (element names, attribute names and values, etc.) but some is private and only makes sense to hoxml.
@@ -75,19 +199,44 @@ typedef struct {
     char* attribute; /**< Holds the current attribute's name. */
     char* value; /**< Holds the current attribute's value. */
     char* content; /**< Holds the current element's content. This means all character data found, including spaces. */
+                   /**< With HOXML_OPTION_TEXT, holds the part of it being returned with HOXML_TEXT instead. */
+    size_t tag_length; /**< Length, in bytes and without a terminator, of 'tag' or with HOXML_OPTION_VIEWS, its view. */
+    size_t attribute_length; /**< Length, in bytes, of 'attribute' or its view. */
+    size_t value_length; /**< Length, in bytes, of 'value' or its view. */
+    size_t content_length; /**< Length, in bytes, of 'content' or its view. */
     int line; /**< The line currently being parsed. Lines are determined by line feeds and carriage returns. */
     int column; /**< The column, on the current line, of the character last parsed. */
+                /**< With HOXML_OPTION_LAZY_POSITION, both are only up to date after an error, the end of the */
+                /**< document, or a call to hoxml_position(). */
     int depth; /**< The nested level of elements. Assigned with the level in which the element was found. */
+    int options; /**< Any number of the options defined in hoxml_option_t. Zero, no options, by default. */
+    size_t consumed; /**< With HOXML_OPTION_STREAM, once HOXML_END_OF_DOCUMENT is returned, the number of bytes of */
+                     /**< the XML content string parsed up to the document's end. The next document begins there. */
+    hoxml_view_t tag_view; /**< With HOXML_OPTION_VIEWS, holds the name of the tag or PI target. */
+    hoxml_view_t attribute_view; /**< With HOXML_OPTION_VIEWS, holds the current attribute's name. */
+    hoxml_view_t value_view; /**< With HOXML_OPTION_VIEWS, holds the current attribute's value. */
+    hoxml_view_t content_view; /**< With HOXML_OPTION_VIEWS, holds the current element's or PI's content. */
+    const hoxml_symbols_t* symbols; /**< Names to look up tags and attributes in, or NULL (the default) for none. */
+    int tag_id; /**< With symbols, the ID of the tag's name or -1 if it isn't one of them. */
+    int attribute_id; /**< With symbols, the ID of the current attribute's name or -1 if it isn't one of them. */
+    char version[8]; /**< The document declaration's version (e.g. "1.0"), or an empty string if none was found. */
+    char declared_encoding[48]; /**< The document declaration's encoding (e.g. "UTF-8"), or an empty string. */
+    int standalone; /**< The document declaration's standalone value, 1 for "yes" or 0 for "no", or -1 if none. */
 
     /* Private (for internal use) */
     int is_initialized; /* Set to 1, or true, by hoxml_init() and indicates this context is safe to use */
     const char* xml; /* XML content to be parsed */
     size_t xml_length; /* Length of the XML content to parse */
     int encoding; /* Character encoding of the XML content */
+    int string_encoding; /* Character encoding of the strings on the stack, 'encoding' unless transcoded to UTF-8 */
     const char* iterator; /* Pointer to the character in the XML content being parsed */
+    const char* character; /* Pointer to the current character in the XML content, NULL if pieced together */
+    const char* view; /* Start of a string appended to the stack only as a view into the XML content, or NULL */
+    size_t view_length; /* Length, in bytes, of the 'view' string */
+    char** view_string; /* Public string to point at the view's string if it's copied to the stack, or NULL */
     char* buffer; /* Memory allocated for hoxml to use */
     size_t buffer_length; /* Amount of memory allocated for hoxml */
-    char* reference_start; /* Pointer to a location on the stack where a reference entity string (e.g "&lt;") began */
+    unsigned long reference_value; /* Value of a numeric reference, or the entity trie's node, as it's been found */
     char* stack; /* Pointer to the current node in the stack-like structure of elements */
     int state; /* Current parsing state, determines which characters are acceptable and when to return */
     int post_state; /* When not "none" this indicates a post-state that has a cleanup step */
@@ -96,27 +245,82 @@ typedef struct {
     unsigned long stream; /* Holds the current character, whole or partial. May contain bytes from different strings. */
     size_t stream_length; /* Length of the 'stream' variable in bytes */
     unsigned newline_character; /* The character used to increment the 'line' variable, \r or \n */
+    int depth_change; /* Change to the 'depth' variable to apply when parsing continues, +1 or -1 */
+    int skip_depth; /* Elements open within the one being skipped, or -1 while still within its open tag */
+    unsigned long name_hash; /* Hash of the tag or attribute name being parsed, updated as each character is found */
+    hoxml_allocator_t allocator; /* With hoxml_init_ex(), the functions that allocate blocks of memory as needed */
+    size_t block_length; /* With hoxml_init_ex(), the length of each block unless more is needed */
+    char* spare_block; /* With hoxml_init_ex(), a block no longer used, kept to be used again, or NULL */
+    size_t budget; /* With hoxml_parse_budget(), the number of bytes the current call may parse, or 0 for no limit */
+    const char* budget_end; /* Where the current call's budget runs out in the XML content string, or NULL */
+    const char* position; /* With lazy positions, the first character not yet counted in 'line' and 'column', or NULL */
+    int declaration; /* Progress through the document declaration's content, or HOXML_DECLARATION_NONE outside of it */
+    int declaration_name; /* Index of the declaration's pseudo-attribute being parsed, or last parsed, or -1 */
+    const char* declaration_match; /* Name, or standalone value, that the characters found so far must spell out */
+    size_t declaration_length; /* Number of characters of the pseudo-attribute's name or value found so far */
+    unsigned declaration_quote; /* The quote, " or ', that opened the pseudo-attribute's value */
 } hoxml_context_t;
 
+/**
+ * Functions called by hoxml_parse_sax() as the matching codes are found. Any of them may be NULL to ignore that code.
+ * The context object is read the same way as after hoxml_parse() returns and 'user' is the pointer passed to
+ * hoxml_parse_sax().
+ */
+typedef struct {
+    void (*element_begin)(hoxml_context_t* context, void* user); /**< Called for HOXML_ELEMENT_BEGIN. */
+    void (*element_end)(hoxml_context_t* context, void* user); /**< Called for HOXML_ELEMENT_END. */
+    void (*attribute)(hoxml_context_t* context, void* user); /**< Called for HOXML_ATTRIBUTE. */
+    void (*processing_instruction_begin)(hoxml_context_t* context, void* user); /**< Called for HOXML_PI_BEGIN. */
+    void (*processing_instruction_end)(hoxml_context_t* context, void* user); /**< Called for HOXML_PI_END. */
+    void (*text)(hoxml_context_t* context, void* user); /**< Called for HOXML_TEXT. */
+    void (*error)(hoxml_context_t* context, hoxml_code_t code, void* user); /**< Called for unrecoverable errors. */
+} hoxml_sax_t;
+
 /**
  * Sets up the hoxml context object to begin parsing. Following this, call hoxml_parse() until
  * HOXML_END_OF_DOCUMENT or one of the error values is returned.
  *
  * @param context Pointer to an allocated hoxml context object. This instance will be modified.
  * @param buffer A pointer to some contiguous block of memory for hoxml to use. This will also be modified, frequently.
- * @param buffer_length The length, in bytes, of the buffer handed to hoxml as the 'buffer' parameter.
+ * @param buffer_length The length, in bytes, of the buffer handed to hoxml as the 'buffer' parameter. No more than 4 GB
+ *                      of it is used so, with a buffer that long, HOXML_ERROR_INSUFFICIENT_MEMORY can't be recovered
+ *                      from.
  */
 HOXML_DECL void hoxml_init(hoxml_context_t* context, void* buffer, size_t buffer_length);
 
+/**
+ * Sets up the hoxml context object to begin parsing with memory it allocates itself. Rather than returning
+ * HOXML_ERROR_INSUFFICIENT_MEMORY when memory runs out, hoxml allocates another block and carries on. Only the
+ * element being parsed is moved to the new block, the rest stay where they are, so each new block costs about as much
+ * as that element's strings. Blocks are kept while the elements in them are open. Call hoxml_free() when done.
+ *
+ * @param context Pointer to an allocated hoxml context object. This instance will be modified.
+ * @param block_length The length, in bytes, of each block. Blocks are longer when an element needs more.
+ * @param allocator The functions that allocate and free blocks. They're copied so this object needn't be kept.
+ * @return 1 if the context object is ready or 0 if the first block couldn't be allocated.
+ */
+HOXML_DECL int hoxml_init_ex(hoxml_context_t* context, size_t block_length, const hoxml_allocator_t* allocator);
+
+/**
+ * Frees the memory allocated for a context object set up with hoxml_init_ex(). The context object may then be set up
+ * again. Nothing is done for context objects set up with hoxml_init().
+ *
+ * @param context A hoxml context object.
+ */
+HOXML_DECL void hoxml_free(hoxml_context_t* context);
+
 /**
  * Instruct hoxml to use a new buffer. This maintains the current state of parsing meaning that the next call to
  * hoxml_parse() will continue none the wiser.
  * The buffer must have a length greater than the current buffer and both buffers must be allocated at the time this
- * function is called. Once it returns, the original buffer may and should be freed.
+ * function is called. Once it returns, the original buffer may and should be freed. Context objects set up with
+ * hoxml_init_ex() manage their own memory and are left as they are.
  *
  * @param context An initialized hoxml context object.
  * @param buffer A pointer to a new, contiguous block of memory for hoxml to use.
- * @param buffer_length The length, in bytes, of the buffer handed to hoxml as the 'buffer' parameter.
+ * @param buffer_length The length, in bytes, of the buffer handed to hoxml as the 'buffer' parameter. As with
+ *                      hoxml_init(), no more than 4 GB of it is used so, once the current buffer is that long, a new
+ *                      one won't make room and HOXML_ERROR_INSUFFICIENT_MEMORY can't be recovered from.
  */
 HOXML_DECL void hoxml_realloc(hoxml_context_t* context, void* buffer, size_t buffer_length);
 
@@ -134,6 +338,329 @@ HOXML_DECL void hoxml_realloc(hoxml_context_t* context, void* buffer, size_t buf
  */
 HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, size_t xml_length);
 
+/**
+ * Begin or continue parsing the given XML content string, like hoxml_parse(), but stop after parsing about the given
+ * number of bytes. If no other code is found first, HOXML_YIELD is returned and the next call to hoxml_parse() or
+ * hoxml_parse_budget(), with the same XML content string, continues where this one stopped. This caps the time spent
+ * in each call, for example to spread the parsing of a large document across the frames of a real-time loop.
+ * At least one character is parsed per call and a few bytes more than the budget may be, to finish a character.
+ *
+ * @param context An initialized hoxml context object. This should be treated as read-only until parsing is done.
+ * @param xml XML content as an encoded string. Supported character encodings include ASCII, UTF-8, and UTF-16(BE|LE).
+ * @param xml_length Length of the XML content in bytes.
+ * @param max_bytes Number of bytes of the XML content to parse, at most, before returning HOXML_YIELD.
+ * @return A code indicating what information from the XML content is available, HOXML_YIELD, or an error.
+ */
+HOXML_DECL hoxml_code_t hoxml_parse_budget(hoxml_context_t* context, const char* xml, size_t xml_length,
+    size_t max_bytes);
+
+/**
+ * Bring the context object's 'line' and 'column' variables up to date. With HOXML_OPTION_LAZY_POSITION, they're
+ * otherwise only updated when an error or HOXML_END_OF_DOCUMENT is returned. Only the characters parsed since they
+ * were last updated are counted, so this may be called after every code without counting any character twice. Without
+ * the option, they're always up to date and this does nothing.
+ *
+ * @param context A hoxml context object. The XML content string last passed to it must not have been freed.
+ */
+HOXML_DECL void hoxml_position(hoxml_context_t* context);
+
+/**
+ * Begin or continue parsing the given XML content string, calling the given functions for each code found instead of
+ * returning. Parsing continues in a single call until the end of the document, the end of the XML content string, or
+ * an error. Returned values and error recovery are the same as hoxml_parse() and the two may be used interchangeably.
+ *
+ * @param context An initialized hoxml context object. This should be treated as read-only until parsing is done.
+ * @param xml XML content as an encoded string. Supported character encodings include ASCII, UTF-8, and UTF-16(BE|LE).
+ * @param xml_length Length of the XML content in bytes.
+ * @param sax Functions to call for each code. Functions that are NULL are skipped.
+ * @param user Any pointer, or NULL, passed back to the functions.
+ * @return HOXML_END_OF_DOCUMENT or an error.
+ */
+HOXML_DECL hoxml_code_t hoxml_parse_sax(hoxml_context_t* context, const char* xml, size_t xml_length,
+    const hoxml_sax_t* sax, void* user);
+
+/**
+ * Skip the rest of the element that just began. Call this after hoxml_parse() returns HOXML_ELEMENT_BEGIN, or
+ * HOXML_ATTRIBUTE, for an element that isn't of interest. The next call to hoxml_parse() scans ahead to the matching
+ * close tag, without returning codes for or storing anything nested in the element, and returns its
+ * HOXML_ELEMENT_END. The element's content is not kept so 'content' is NULL at that point.
+ * While skipping, only tags, quoted attribute values, comments, CDATA sections, and processing instructions are
+ * followed to find where the element ends. Most mistakes in the skipped markup are not reported.
+ *
+ * @param context A hoxml context object that just returned HOXML_ELEMENT_BEGIN or HOXML_ATTRIBUTE.
+ * @return 1 if the element will be skipped or 0 if parsing is not within an element's open tag or content.
+ */
+HOXML_DECL int hoxml_skip_element(hoxml_context_t* context);
+
+/**
+ * Find where a whole, UTF-8 or ASCII document can be split into parts that are parsed separately, for example by
+ * several threads. Each part after the first holds some of the root element's children, and the text around them, and
+ * is parsed by its own context object with HOXML_OPTION_FRAGMENT. The first part is parsed as usual. Parts are about
+ * the same length but no element is split so there may be fewer of them than allowed.
+ * Only tags, quoted attribute values, comments, CDATA sections, processing instructions, and declarations are followed
+ * to find the root's children. Mistakes in the markup are left for the parsers to report.
+ *
+ * @param xml The whole XML content.
+ * @param xml_length Length of the XML content in bytes.
+ * @param offsets Array that receives the offset, in bytes, of each part. The first part's offset is always zero.
+ * @param max_parts The largest number of parts wanted, the length of the 'offsets' array.
+ * @return The number of parts, one if the document can't be split (e.g. it's UTF-16), or zero for invalid parameters.
+ */
+HOXML_DECL size_t hoxml_split(const char* xml, size_t xml_length, size_t* offsets, size_t max_parts);
+
+/**
+ * Sets up a symbol table of tag and attribute names. Once assigned to a context object's 'symbols' variable, each
+ * tag's and attribute's name is looked up as it's parsed and its ID, its index in 'names', is assigned to 'tag_id' or
+ * 'attribute_id'. Close tags are then matched to open tags by ID where possible. The same symbol table may be used by
+ * any number of context objects at once.
+ *
+ * @param symbols Pointer to an allocated symbol table object. This instance will be modified.
+ * @param names The names, encoded with UTF-8 or ASCII. The array and strings must remain valid while it's used.
+ * @param name_count Number of names.
+ * @param slots Memory for the table's slots. It must remain valid while the symbol table is used.
+ * @param slot_count Number of slots, a power of two greater than 'name_count'. Twice 'name_count' or more is best.
+ * @return 1 if the symbol table is ready or 0 if a parameter was unacceptable, including more than 1048574 names.
+ */
+HOXML_DECL int hoxml_symbols_init(hoxml_symbols_t* symbols, const char* const* names, size_t name_count, int* slots,
+    size_t slot_count);
+
+/**
+ * Converts the current attribute's value and stores it in a field of the given structure if the attribute is bound to
+ * one. Call it after HOXML_ATTRIBUTE is returned by a context object with a symbol table. Bindings are searched in
+ * order and the first with the attribute's ID, and the element's ID or -1, is used. Leading and trailing whitespace
+ * in the value is ignored.
+ *
+ * @param context A hoxml context object that just returned HOXML_ATTRIBUTE.
+ * @param bindings Array of bindings.
+ * @param binding_count Number of bindings.
+ * @param object Pointer to the structure whose fields are bound.
+ * @return 1 if the value was stored, 0 if the attribute isn't bound, or -1 if the value couldn't be converted to the
+ *         field's type (e.g. "abc" for HOXML_BIND_INT or a number that's out of range), leaving the field unmodified.
+ */
+HOXML_DECL int hoxml_bind_attribute(const hoxml_context_t* context, const hoxml_binding_t* bindings,
+    size_t binding_count, void* object);
+
+/**
+ * Converts the current attribute's value to a long. The value is read in the document's encoding, with leading and
+ * trailing whitespace ignored, so there's no need to transcode or copy it first.
+ *
+ * @param context A hoxml context object that just returned HOXML_ATTRIBUTE.
+ * @param value Pointer to the long that receives the value.
+ * @return 1 if the value was converted or 0 if there's no value or it isn't a decimal integer within the range of a
+ *         long, leaving 'value' unmodified.
+ */
+HOXML_DECL int hoxml_value_as_long(const hoxml_context_t* context, long* value);
+
+/**
+ * Converts the current attribute's value, which must not be negative, to an unsigned long like hoxml_value_as_long().
+ */
+HOXML_DECL int hoxml_value_as_unsigned_long(const hoxml_context_t* context, unsigned long* value);
+
+/**
+ * Converts the current attribute's value, a decimal number (e.g. "-0.25" or "1.5e3"), to a double like
+ * hoxml_value_as_long(). Most numbers are converted exactly, and without strtod(), and the rest are converted by it.
+ * Either way, the decimal point is always '.' whatever the current locale. The rest, those with more than 15
+ * significant digits or exponents past 22, are the only time hoxml reads global state: strtod() sets errno and
+ * localeconv() reads the locale, which must not be changed with setlocale() by another thread meanwhile.
+ */
+HOXML_DECL int hoxml_value_as_double(const hoxml_context_t* context, double* value);
+
+/**
+ * Converts the current attribute's value to 1 for "true" or "1" and 0 for "false" or "0" like hoxml_value_as_long().
+ */
+HOXML_DECL int hoxml_value_as_bool(const hoxml_context_t* context, int* value);
+
+/**
+ * Converts the current element's content to a long like hoxml_value_as_long(). Call it after HOXML_ELEMENT_END.
+ */
+HOXML_DECL int hoxml_content_as_long(const hoxml_context_t* context, long* value);
+
+/**
+ * Converts the current element's content to an unsigned long like hoxml_value_as_unsigned_long().
+ */
+HOXML_DECL int hoxml_content_as_unsigned_long(const hoxml_context_t* context, unsigned long* value);
+
+/**
+ * Converts the current element's content to a double like hoxml_value_as_double().
+ */
+HOXML_DECL int hoxml_content_as_double(const hoxml_context_t* context, double* value);
+
+/**
+ * Converts the current element's content to a boolean like hoxml_value_as_bool().
+ */
+HOXML_DECL int hoxml_content_as_bool(const hoxml_context_t* context, int* value);
+
+/**
+ * Sets up a decoder to decode content of the given format into the given array.
+ *
+ * @param decoder Pointer to an allocated decoder object. This instance will be modified.
+ * @param format One of the formats defined in hoxml_data_format_t.
+ * @param values Array that receives the integers.
+ * @param max_values Length of the array.
+ */
+HOXML_DECL void hoxml_decoder_init(hoxml_decoder_t* decoder, int format, unsigned long* values, size_t max_values);
+
+/**
+ * Decodes the current element's content after HOXML_ELEMENT_END or, with HOXML_OPTION_TEXT, each part of it after
+ * HOXML_TEXT so the whole content never has to be held in the buffer. Integers, and base64's groups of characters,
+ * may be split between parts. The content is read in the document's encoding without transcoding it.
+ *
+ * @param decoder A decoder object.
+ * @param context A hoxml context object that just returned HOXML_ELEMENT_END or HOXML_TEXT.
+ * @return 1 if the content was decoded or 0 if it, or any before it, was malformed or held too many integers.
+ */
+HOXML_DECL int hoxml_decoder_decode(hoxml_decoder_t* decoder, const hoxml_context_t* context);
+
+/**
+ * Decodes anything left over once all of the content has been passed to hoxml_decoder_decode(), like the last CSV
+ * integer, and checks that the data was complete.
+ *
+ * @param decoder A decoder object.
+ * @return 1 if all of the data was decoded, 'value_count' integers of it, or 0 if it was malformed, incomplete, or held
+ *         too many integers.
+ */
+HOXML_DECL int hoxml_decoder_finish(hoxml_decoder_t* decoder);
+
+#ifdef HOXML_ENABLE_FILE
+/**
+ * Holds an XML file's content, mapped to memory or read into it, and the context object and buffer to parse it with.
+ */
+typedef struct {
+    /* Public */
+    hoxml_context_t context; /**< Context object used to parse the file. Read it as usual while parsing. */
+    const char* xml; /**< The file's content. Valid until hoxml_file_close(). */
+    size_t xml_length; /**< Length of the file's content in bytes. */
+
+    /* Private (for internal use) */
+    void* buffer; /* Memory allocated for the context object to use, grown as needed */
+    size_t buffer_length; /* Length of the allocated buffer */
+    int is_mapped; /* Set to 1, or true, if the content is mapped to memory rather than read into allocated memory */
+} hoxml_file_t;
+
+/**
+ * Opens the XML file at the given path and sets up the file object to parse it. Where supported, the file is mapped
+ * to memory. Otherwise, it's read into allocated memory. The file object's context is initialized with no options.
+ * Options may be assigned to it before calling hoxml_file_parse() for the first time.
+ *
+ * @param file Pointer to an allocated hoxml file object. This instance will be modified.
+ * @param path Path to the XML file.
+ * @return 1 if the file was opened or 0 if it couldn't be opened, was empty, or memory couldn't be allocated.
+ */
+HOXML_DECL int hoxml_file_open(hoxml_file_t* file, const char* path);
+
+/**
+ * Begin or continue parsing the opened file. This is equivalent to hoxml_parse() with the whole file as the XML content
+ * string except that the buffer is grown automatically. HOXML_ERROR_INSUFFICIENT_MEMORY is only returned if more
+ * memory couldn't be allocated and HOXML_ERROR_UNEXPECTED_EOF is only returned if the document is incomplete.
+ *
+ * @param file A hoxml file object opened by hoxml_file_open().
+ * @return A code indicating what information from the file is available or an error.
+ */
+HOXML_DECL hoxml_code_t hoxml_file_parse(hoxml_file_t* file);
+
+/**
+ * Parse the opened file, calling the given functions for each code found. This is equivalent to hoxml_parse_sax() with
+ * the whole file as the XML content string except that the buffer is grown automatically.
+ *
+ * @param file A hoxml file object opened by hoxml_file_open().
+ * @param sax Functions to call for each code. Functions that are NULL are skipped.
+ * @param user Any pointer, or NULL, passed back to the functions.
+ * @return HOXML_END_OF_DOCUMENT or an error.
+ */
+HOXML_DECL hoxml_code_t hoxml_file_parse_sax(hoxml_file_t* file, const hoxml_sax_t* sax, void* user);
+
+/**
+ * Unmaps or frees the file's content and frees the buffer. Strings from the file object's context are invalid after.
+ *
+ * @param file A hoxml file object opened by hoxml_file_open().
+ */
+HOXML_DECL void hoxml_file_close(hoxml_file_t* file);
+#endif /* HOXML_ENABLE_FILE */
+
+#ifdef HOXML_ENABLE_INDEX
+/**
+ * Flags of an index entry.
+ */
+typedef enum {
+    HOXML_INDEX_NAME_COPIED = 1, /**< The entry's name is in the index's strings rather than the XML content. */
+    HOXML_INDEX_VALUE_COPIED = 2, /**< The entry's value is in the index's strings rather than the XML content. */
+    HOXML_INDEX_HAS_VALUE = 4 /**< The entry has a value. Element ends without content and PI begins don't. */
+} hoxml_index_flag_t;
+
+/**
+ * One code found in the document. Strings are held as offsets so an entry holds no pointers and may be stored as-is.
+ */
+typedef struct {
+    int code; /**< HOXML_ELEMENT_BEGIN, HOXML_ELEMENT_END, HOXML_ATTRIBUTE, or a processing instruction code. */
+    int depth; /**< The context object's 'depth' variable when the code was found. */
+    size_t end; /**< Index of the entry ending this element or PI, if this entry begins one, or else of this entry. */
+    size_t name; /**< Offset of the tag, PI target, or attribute name in the XML content or the index's strings. */
+    size_t name_length; /**< Length of the name in bytes. */
+    size_t value; /**< Offset of the attribute's value or the element's or PI's content, if any. */
+    size_t value_length; /**< Length of the value in bytes. */
+    int flags; /**< Any number of the flags defined in hoxml_index_flag_t. */
+} hoxml_index_entry_t;
+
+/**
+ * Every code found in a document, in document order, and the strings that couldn't be read from the XML content.
+ */
+typedef struct {
+    /* Public */
+    const char* xml; /**< The XML content the index was built from. Reassign it if the same content is moved. */
+    size_t xml_length; /**< Length of the XML content in bytes. */
+    hoxml_index_entry_t* entries; /**< The entries, one per code. */
+    size_t entry_count; /**< Number of entries. */
+    char* strings; /**< Strings that had to be copied, like those containing references. */
+    size_t strings_length; /**< Length of the copied strings in bytes. */
+    int line; /**< The line parsing stopped on if hoxml_index_build() returned an error. */
+    int column; /**< The column parsing stopped on if hoxml_index_build() returned an error. */
+
+    /* Private (for internal use) */
+    size_t entry_capacity; /* Number of entries allocated */
+    size_t strings_capacity; /* Length of the memory allocated for the copied strings */
+} hoxml_index_t;
+
+/**
+ * Parses a whole XML content string and records every code found in an index. Element content is recorded with the
+ * element's end as it would be returned with HOXML_ELEMENT_END. Once built, the index can be read any number of times
+ * and an element's children can be skipped by continuing after the entry indicated by its 'end' variable.
+ *
+ * @param index Pointer to an allocated hoxml index object. This instance will be modified.
+ * @param xml The complete XML content as an encoded string. It must remain valid for as long as the index is read.
+ * @param xml_length Length of the XML content in bytes.
+ * @param options Any number of the options defined in hoxml_option_t. HOXML_OPTION_TEXT is ignored.
+ * @return HOXML_END_OF_DOCUMENT if the document was indexed or an error, including HOXML_ERROR_UNEXPECTED_EOF if the
+ *         document is incomplete and HOXML_ERROR_INSUFFICIENT_MEMORY if memory couldn't be allocated. Either way, free
+ *         the index with hoxml_index_free() afterward.
+ */
+HOXML_DECL hoxml_code_t hoxml_index_build(hoxml_index_t* index, const char* xml, size_t xml_length, int options);
+
+/**
+ * Gets the name of an index entry: its tag, PI target, or attribute name.
+ *
+ * @param index A hoxml index object built by hoxml_index_build().
+ * @param entry Index of the entry.
+ * @return The name, pointing into the XML content or the index's strings. It's not null terminated.
+ */
+HOXML_DECL hoxml_view_t hoxml_index_name(const hoxml_index_t* index, size_t entry);
+
+/**
+ * Gets the value of an index entry: its attribute value or its element's or PI's content.
+ *
+ * @param index A hoxml index object built by hoxml_index_build().
+ * @param entry Index of the entry.
+ * @return The value, pointing into the XML content or the index's strings, or a view with NULL data if there's none.
+ */
+HOXML_DECL hoxml_view_t hoxml_index_value(const hoxml_index_t* index, size_t entry);
+
+/**
+ * Frees the index's entries and strings.
+ *
+ * @param index A hoxml index object built by hoxml_index_build().
+ */
+HOXML_DECL void hoxml_index_free(hoxml_index_t* index);
+#endif /* HOXML_ENABLE_INDEX */
+
 #ifdef __cplusplus
     }
 #endif /* __cplusplus */
@@ -189,6 +716,7 @@ enum {
     HOXML_STATE_PROCESSING_INSTRUCTION_TARGET1,
     HOXML_STATE_PROCESSING_INSTRUCTION_TARGET2,
     HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT,
+    HOXML_STATE_PROCESSING_INSTRUCTION_QUESTION,
     HOXML_STATE_PROCESSING_INSTRUCTION_END,
     HOXML_STATE_DTD_BEGIN1,
     HOXML_STATE_DTD_BEGIN2,
@@ -201,10 +729,28 @@ enum {
     HOXML_STATE_DTD_NAME,
     HOXML_STATE_DTD_CONTENT,
     HOXML_STATE_DTD_OPEN_BRACKET,
+    HOXML_STATE_SKIP_CONTENT,
+    HOXML_STATE_SKIP_MARKUP,
+    HOXML_STATE_SKIP_TAG,
+    HOXML_STATE_SKIP_TAG_SLASH,
+    HOXML_STATE_SKIP_DOUBLE_QUOTE,
+    HOXML_STATE_SKIP_SINGLE_QUOTE,
+    HOXML_STATE_SKIP_END_TAG,
+    HOXML_STATE_SKIP_DECLARATION,
+    HOXML_STATE_SKIP_COMMENT_BEGIN,
+    HOXML_STATE_SKIP_COMMENT,
+    HOXML_STATE_SKIP_COMMENT_END1,
+    HOXML_STATE_SKIP_COMMENT_END2,
+    HOXML_STATE_SKIP_CDATA,
+    HOXML_STATE_SKIP_CDATA_END1,
+    HOXML_STATE_SKIP_CDATA_END2,
+    HOXML_STATE_SKIP_PROCESSING_INSTRUCTION,
+    HOXML_STATE_SKIP_PROCESSING_INSTRUCTION_END,
     HOXML_STATE_DONE,
     /* Post (i.e. after) parser states indicating actions to take on the next call to hoxml_parse() */
     HOXML_POST_STATE_TAG_END,
-    HOXML_POST_STATE_ATTRIBUTE_END
+    HOXML_POST_STATE_ATTRIBUTE_END,
+    HOXML_POST_STATE_TEXT_END
 };
 
 enum {
@@ -214,8 +760,9 @@ enum {
     HOXML_FLAG_DOUBLE_QUOTE = 8, /* The value string being parsed was opened with a double quote (") */
     HOXML_FLAG_TERMINATED = 16, /* The node's current string (tag, attribute, etc.) is null terminated */
     HOXML_FLAG_BEGUN = 32, /* The "element begun" code was already returned for this node */
-    HOXML_FLAG_INCREMENT_DEPTH = 64, /* Context object's depth value should increase by one next hoxml_parse() */
-    HOXML_FLAG_DECREMENT_DEPTH = 128 /* Context object's depth value should decrease by one next hoxml_parse() */
+    HOXML_FLAG_VIEW = 64, /* The node's current string is, so far, only a view into the XML content */
+    HOXML_FLAG_ATTRIBUTE_VIEW = 128, /* The current attribute's name is only a view into the XML content */
+    HOXML_FLAG_FRAGMENT = 256 /* The node stands in for the element enclosing a fragment, it has no tag */
 };
 
 enum {
@@ -236,53 +783,224 @@ enum {
     HOXML_REF_TYPE_HEX /* A value of a character given as a hexadecimal number */
 };
 
-struct _hoxml_node_t;
-typedef struct _hoxml_node_t {
-    struct _hoxml_node_t* parent; /* Points to the parent node, or NULL if this is the root */
-    char* end; /* Points to the last byte of this node's data */
-    int flags; /* May contain any number of the flags defined in hoxml_node_flags */
+enum {
+    HOXML_DECLARATION_NONE = 0, /* Not in a document declaration's content */
+    HOXML_DECLARATION_SPACE, /* Found a value's closing quote, looking for whitespace or the '?' of "?>" */
+    HOXML_DECLARATION_NAME_BEGIN, /* Found whitespace, looking for a pseudo-attribute's name or the '?' of "?>" */
+    HOXML_DECLARATION_NAME, /* Found the first character of a name, looking for the rest of it */
+    HOXML_DECLARATION_ASSIGNMENT, /* Found a name, looking for '=' */
+    HOXML_DECLARATION_QUOTE, /* Found '=', looking for the quote that opens the value */
+    HOXML_DECLARATION_VALUE /* Found the opening quote, looking for the value's characters and the closing quote */
+};
+
+enum {
+    HOXML_CLASS_NAME_START = 1, /* May begin a name (NameStartChar in the XML specification) */
+    HOXML_CLASS_NAME = 2, /* May follow the first character of a name (NameChar in the XML specification) */
+    HOXML_CLASS_WHITESPACE = 4, /* Space, tab, carriage return, or line feed */
+    HOXML_CLASS_DELIMITER = 8, /* Can't be character data as-is because it begins markup, '<' or '&' */
+    HOXML_CLASS_HEX = 16, /* Hexadecimal digit */
+    HOXML_CLASS_DIGIT = 32 /* Decimal digit */
+};
+
+/* Nodes hold offsets rather than pointers so that the stack can be moved to another buffer as it is. Offsets are */
+/* 32-bit so buffers are limited to 4 GB. */
+typedef struct {
+    unsigned parent; /* Offset of the parent node from the beginning of the buffer, or HOXML_NO_PARENT for the root */
+    unsigned end; /* Offset of the last byte of this node's data from the beginning of the node */
+    unsigned flags; /* Flags defined in hoxml_node_flags in the low HOXML_FLAG_BITS bits, the tag's ID plus one above */
     char tag; /* Where the tag string will be stored in the buffer, must be defined last */
 } hoxml_node_t;
 
+/* Found at the beginning of each block of memory allocated by a context object set up with hoxml_init_ex() */
+typedef struct {
+    char* previous; /* Points to the block that was in use when this one was allocated, or NULL for the first */
+    size_t length; /* Length of the block, including this header, in bytes */
+} hoxml_block_t;
+
 typedef struct {
     unsigned encoded; /* Character as it appeared in the content. In other words, the original, encoded character. */
     unsigned codepoint; /* Unicode codepoint of the character. In other words, the decoded character. */
     size_t bytes; /* Number of eight-bit bytes of the encoded character, in the [1, 4] range */
 } hoxml_character_t;
 
+typedef struct {
+    unsigned first; /* First codepoint in the range */
+    unsigned last; /* Last codepoint in the range, inclusive */
+    int classes; /* Classes, defined in an enumeration, that every character in the range belongs to */
+} hoxml_character_range_t;
+
+typedef struct {
+    char character; /* Character matched by this node */
+    unsigned char child; /* Index of the first node that may match the next character, or zero if there are none */
+    unsigned char sibling; /* Index of the next node that may match this character instead, or zero if none */
+    char expansion; /* Character the reference expands to if the entity's name ends with this node, or zero */
+} hoxml_entity_node_t;
+
+/* Classes of each character in the ASCII and Latin-1 ranges, indexed by codepoint. Each is any number of the */
+/* HOXML_CLASS_* flags combined with bitwise OR. */
+static const unsigned char hoxml_character_classes[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x00, /* 0x00-0x0F */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0x10-0x1F */
+    0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x02, 0x00, /* 0x20-0x2F */
+    0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x03, 0x00, 0x08, 0x00, 0x00, 0x00, /* 0x30-0x3F */
+    0x00, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, /* 0x40-0x4F */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x03, /* 0x50-0x5F */
+    0x00, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, /* 0x60-0x6F */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0x70-0x7F */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0x80-0x8F */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0x90-0x9F */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0xA0-0xAF */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* 0xB0-0xBF */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, /* 0xC0-0xCF */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, /* 0xD0-0xDF */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, /* 0xE0-0xEF */
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03  /* 0xF0-0xFF */
+};
+
+/* Classes of the characters beyond the Latin-1 range that can be part of a name, in ascending order. All others */
+/* belong to no class. */
+static const hoxml_character_range_t hoxml_character_ranges[] = {
+    { 0x00100, 0x002FF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x00300, 0x0036F, HOXML_CLASS_NAME },
+    { 0x00370, 0x0037D, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x0037F, 0x01FFF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x0200C, 0x0200D, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x0203F, 0x02040, HOXML_CLASS_NAME },
+    { 0x02070, 0x0218F, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x02C00, 0x02FEF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x03001, 0x0D7FF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x0F900, 0x0FDCF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x0FDF0, 0x0FFFD, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME },
+    { 0x10000, 0xEFFFF, HOXML_CLASS_NAME_START | HOXML_CLASS_NAME }
+};
+
+/* The predefined entities, "amp", "apos", "gt", "lt", and "quot", as a trie matched one character at a time. The */
+/* first node is the first of the names' first characters. */
+static const hoxml_entity_node_t hoxml_entity_trie[] = {
+    { 'a', 1, 6, 0 }, /* 0 */
+    { 'm', 2, 3, 0 }, /* 1: "am" */
+    { 'p', 0, 0, '&' }, /* 2: "amp" */
+    { 'p', 4, 0, 0 }, /* 3: "ap" */
+    { 'o', 5, 0, 0 }, /* 4: "apo" */
+    { 's', 0, 0, '\'' }, /* 5: "apos" */
+    { 'g', 7, 8, 0 }, /* 6 */
+    { 't', 0, 0, '>' }, /* 7: "gt" */
+    { 'l', 9, 10, 0 }, /* 8 */
+    { 't', 0, 0, '<' }, /* 9: "lt" */
+    { 'q', 11, 0, 0 }, /* 10 */
+    { 'u', 12, 0, 0 }, /* 11: "qu" */
+    { 'o', 13, 0, 0 }, /* 12: "quo" */
+    { 't', 0, 0, '"' } /* 13: "quot" */
+};
+
 #ifndef UINT32_MAX /* Defined in stdint.h with later revisions of C and C++ but not for some earlier ones */
     #define UINT32_MAX (0xffffffff)
 #endif
 #define HOXML_STACK ((hoxml_node_t*)context->stack)
+#define HOXML_NODE_OF(s) ((hoxml_node_t*)((s) - offsetof(hoxml_node_t, tag))) /* Node holding a tag's name */
+#define HOXML_END(n) ((char*)(n) + (n)->end) /* Last byte of a node's data */
+#define HOXML_NO_PARENT UINT32_MAX /* Parent offset of the root node */
+#define HOXML_FLAG_BITS 12 /* Node flags are in the low bits of a node's 'flags' word and the tag's ID in the rest */
+#define HOXML_NODE_ID(n) ((int)((n)->flags >> HOXML_FLAG_BITS) - 1)
+#define HOXML_SET_NODE_ID(n, i) (n)->flags = ((n)->flags & ((1u << HOXML_FLAG_BITS) - 1)) | \
+    (unsigned)((i) + 1) << HOXML_FLAG_BITS
+#define HOXML_SYMBOL_NONE (-1) /* ID of a name not found in the symbol table */
+#define HOXML_MAX_SYMBOLS ((UINT32_MAX >> HOXML_FLAG_BITS) - 1) /* The most names a symbol table may have */
+/* Names are hashed with 32-bit FNV-1a over their codepoints so hashes don't depend on the encoding */
+#define HOXML_HASH_BASIS 2166136261UL
+#define HOXML_HASH(h, c) ((((h) ^ (unsigned long)(c)) * 16777619UL) & 0xFFFFFFFFUL)
+#define HOXML_MINIMUM_BLOCK_LENGTH (sizeof(hoxml_block_t) + 8 * sizeof(hoxml_node_t))
+#define HOXML_NUMBER_LENGTH 64 /* Longest number, in characters, that a value or content can be converted from */
 #define HOXML_TO_LOWER(c) (c >= 'A' && c <= 'Z' ? c + 32 : c)
 #define HOXML_IS_NEW_LINE(c) (c == 0x0A || c == 0x0D)
-#define HOXML_IS_WHITESPACE(c) (c == 0x20 || c == 0x09 || HOXML_IS_NEW_LINE(c))
+/* Classes of any codepoint, looked up in the table or, beyond the Latin-1 range, the list of ranges */
+#define HOXML_CLASSES(c) ((c) < 0x100 ? (int)hoxml_character_classes[(c) & 0xFF] : hoxml_classify_range(c))
+/* Whether a codepoint belongs to a class that only has characters in the ASCII and Latin-1 ranges */
+#define HOXML_HAS_CLASS(c, k) ((c) < 0x100 && (hoxml_character_classes[(c) & 0xFF] & (k)) != 0)
+#define HOXML_IS_WHITESPACE(c) HOXML_HAS_CLASS(c, HOXML_CLASS_WHITESPACE)
 #define HOXML_IS_ASCII_CHAR(c) (c >= 0x21 && c <= 0x7F)
-#define HOXML_IS_CHAR_DATA(c) (c != '<' && c != '&')
-#define HOXML_IS_ALPHA(c) ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
-#define HOXML_IS_NUMERIC(c) (c >= '0' && c <= '9')
-#define HOXML_IS_NAME_START_CHAR(c) (HOXML_IS_ALPHA(c) || c == ':' || c == '_' || (c >= 0xC0 && c <= 0xD6) || \
-    (c >= 0xD8 && c <= 0xF6) || c >= 0xF8)
-#define HOXML_IS_NAME_CHAR(c) (HOXML_IS_NAME_START_CHAR(c) || c == '-' || c == '.'|| HOXML_IS_NUMERIC(c))
-#define HOXML_IS_HEX_CHAR(c) (HOXML_IS_NUMERIC(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
-#define HOXML_IS_VALUE_CHAR_DATA(f, c) (HOXML_IS_CHAR_DATA(c) && ((f & HOXML_FLAG_DOUBLE_QUOTE && c != '"') || \
-    c != '\''))
+#define HOXML_IS_CHAR_DATA(c) (!HOXML_HAS_CLASS(c, HOXML_CLASS_DELIMITER))
+#define HOXML_IS_NUMERIC(c) HOXML_HAS_CLASS(c, HOXML_CLASS_DIGIT)
+#define HOXML_IS_NAME_START_CHAR(c) ((HOXML_CLASSES(c) & HOXML_CLASS_NAME_START) != 0)
+#define HOXML_IS_NAME_CHAR(c) ((HOXML_CLASSES(c) & HOXML_CLASS_NAME) != 0)
+#define HOXML_IS_UTF_16(e) (e == HOXML_ENC_UTF_16_LE || e == HOXML_ENC_UTF_16_BE)
+/* The code unit at the given pointer, a byte or, in UTF-16, two. ASCII characters are always a single unit. */
+#define HOXML_CODE_UNIT(s, e) ((e) == HOXML_ENC_UTF_16_LE ? \
+        (unsigned)(unsigned char)(s)[0] | ((unsigned)(unsigned char)(s)[1] << 8) : (e) == HOXML_ENC_UTF_16_BE ? \
+        ((unsigned)(unsigned char)(s)[0] << 8) | (unsigned char)(s)[1] : (unsigned)(unsigned char)(s)[0])
+#define HOXML_IS_HEX_CHAR(c) HOXML_HAS_CLASS(c, HOXML_CLASS_HEX)
+#define HOXML_IS_VALUE_CHAR_DATA(f, c) (HOXML_IS_CHAR_DATA(c) && c != (f & HOXML_FLAG_DOUBLE_QUOTE ? '"' : '\''))
+/* Word-at-a-time (SWAR) helpers operating on all bytes of an unsigned long at once, whatever its size */
+#define HOXML_WORD_ONES ((unsigned long)-1 / 0xFF) /* 0x0101...01 */
+#define HOXML_WORD_HIGHS (HOXML_WORD_ONES * 0x80) /* 0x8080...80 */
+#define HOXML_WORD_HAS_ZERO(w) (((w) - HOXML_WORD_ONES) & ~(w) & HOXML_WORD_HIGHS)
+#define HOXML_WORD_HAS_BYTE(w, b) HOXML_WORD_HAS_ZERO((w) ^ (HOXML_WORD_ONES * (unsigned long)(b)))
 
 void hoxml_push_stack(hoxml_context_t* context);
 void hoxml_pop_stack(hoxml_context_t* context);
+hoxml_node_t* hoxml_parent(hoxml_context_t* context, hoxml_node_t* node);
+int hoxml_grow(hoxml_context_t* context);
+void hoxml_release_block(hoxml_context_t* context);
+void hoxml_spare_block(hoxml_context_t* context, char* block);
 void hoxml_append_character(hoxml_context_t* context, hoxml_character_t c);
 void hoxml_append_terminator(hoxml_context_t* context);
+void hoxml_scan_character_data(hoxml_context_t* context);
+void hoxml_count_position(hoxml_context_t* context);
+void hoxml_copy_views(hoxml_context_t* context);
+void hoxml_set_lengths(hoxml_context_t* context);
+void hoxml_set_views(hoxml_context_t* context);
+int hoxml_match_entity(hoxml_context_t* context, unsigned codepoint, int is_first);
 void hoxml_end_reference(hoxml_context_t* context, int type);
+int hoxml_parse_declaration(hoxml_context_t* context, unsigned codepoint);
 void hoxml_begin_tag(hoxml_context_t* context);
+void hoxml_begin_fragment(hoxml_context_t* context);
+void hoxml_begin_document(hoxml_context_t* context);
 hoxml_code_t hoxml_end_tag(hoxml_context_t* context);
+hoxml_code_t hoxml_end_skip(hoxml_context_t* context);
+int hoxml_end_text(hoxml_context_t* context);
+hoxml_code_t hoxml_run(hoxml_context_t* context);
 int hoxml_post_state_cleanup(hoxml_context_t* context);
+int hoxml_find_symbol(const hoxml_symbols_t* symbols, unsigned long hash, const char* str, size_t length,
+    int encoding);
+int hoxml_convert(const hoxml_context_t* context, int is_content, int type, const hoxml_symbols_t* values,
+    void* field);
+int hoxml_convert_string(const char* str, size_t length, int encoding, int type, const hoxml_symbols_t* values,
+    void* field);
+int hoxml_parse_integer(const char* number, size_t length, unsigned long limit, unsigned long* magnitude);
+int hoxml_parse_double(char* number, size_t length, double* d);
+void hoxml_decode_csv(hoxml_decoder_t* decoder, const char* str, size_t length, int encoding);
+void hoxml_decode_base64(hoxml_decoder_t* decoder, const char* str, size_t length, int encoding);
+void hoxml_end_base64(hoxml_decoder_t* decoder);
+void hoxml_store_value(hoxml_decoder_t* decoder);
+size_t hoxml_split_find(const char* xml, size_t xml_length, size_t from, const char* terminator);
+size_t hoxml_split_tag(const char* xml, size_t xml_length, size_t from);
+int hoxml_classify_range(unsigned codepoint);
 hoxml_character_t hoxml_decode_character(const char* str, size_t str_length, int encoding);
 hoxml_character_t hoxml_encode_character(unsigned codepoint, int encoding);
-char* hoxml_to_ascii(const char* str, int encoding);
 size_t hoxml_strlen(const char* str, int encoding);
 int hoxml_strcmp(const char* str1, int encoding1, const char* str2, int encoding2, int sensitivity);
-const char* hoxml_strstr(const char* haystack, int haystack_encoding, const char* needle, int needle_encoding,
-    int sensitivity);
+#ifdef HOXML_ENABLE_FILE
+    int hoxml_file_grow(hoxml_file_t* file);
+    #if defined(_WIN32)
+        #include <windows.h> /* CloseHandle(), CreateFileA(), CreateFileMappingA(), MapViewOfFile(), etc. */
+        #define HOXML_FILE_WIN32
+    #elif defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+        #include <fcntl.h> /* open(), O_RDONLY */
+        #include <sys/mman.h> /* madvise(), mmap(), munmap() */
+        #include <sys/stat.h> /* fstat() */
+        #include <unistd.h> /* close() */
+        #define HOXML_FILE_POSIX
+    #endif
+    #include <stdio.h> /* fclose(), fopen(), fread(), fseek(), ftell() */
+    #define HOXML_FILE_BUFFER_LENGTH 4096 /* Initial length of a file object's buffer, doubled whenever it runs out */
+#endif
+#ifdef HOXML_ENABLE_INDEX
+    int hoxml_index_add(hoxml_index_t* index, hoxml_context_t* context, hoxml_code_t code, size_t* open_entry);
+    int hoxml_index_store(hoxml_index_t* index, hoxml_view_t view, size_t* offset, size_t* length, int* is_copied);
+    #define HOXML_INDEX_BUFFER_LENGTH 4096 /* Initial length of the buffer used while indexing, doubled as needed */
+    #define HOXML_INDEX_NONE ((size_t)-1) /* Entry index meaning no entry */
+#endif
+
 #ifdef HOXML_DEBUG
     #include <stdio.h> /* printf() */
     #define HOXML_LOG_STATE(s) printf("%s\n", s);
@@ -297,28 +1015,70 @@ HOXML_DECL void hoxml_init(hoxml_context_t* context, void* buffer, size_t buffer
     memset(context, 0, sizeof(hoxml_context_t)); /* Assign all values of the context to zero */
     context->buffer = (char*)buffer; /* Use the provided buffer */
     context->buffer_length = buffer_length; /* Remember the length of the provided buffer */
+    if (context->buffer_length > UINT32_MAX) /* Nodes' offsets are 32-bit so any more can't be used */
+        context->buffer_length = UINT32_MAX;
     context->line = 1; /* This is meant to be human-readable and humans begin counting at one */
+    context->tag_id = context->attribute_id = HOXML_SYMBOL_NONE;
+    context->standalone = -1; /* Empty strings and -1 mean no document declaration has been found */
     context->is_initialized = 1;
-    memset(buffer, 0, buffer_length); /* Fill the buffer with zeroes */
+}
+
+HOXML_DECL int hoxml_init_ex(hoxml_context_t* context, size_t block_length, const hoxml_allocator_t* allocator) {
+    char* block;
+
+    if (context == NULL || allocator == NULL || allocator->allocate == NULL || allocator->release == NULL)
+        return 0;
+
+    /* Each block must at least have room for its header and a node */
+    if (block_length < HOXML_MINIMUM_BLOCK_LENGTH)
+        block_length = HOXML_MINIMUM_BLOCK_LENGTH;
+    if ((block = (char*)allocator->allocate(block_length, allocator->user)) == NULL)
+        return 0;
+    ((hoxml_block_t*)block)->previous = NULL;
+    ((hoxml_block_t*)block)->length = block_length;
+    hoxml_init(context, block + sizeof(hoxml_block_t), block_length - sizeof(hoxml_block_t));
+    context->allocator = *allocator;
+    context->block_length = block_length;
+    return 1;
+}
+
+HOXML_DECL void hoxml_free(hoxml_context_t* context) {
+    char* block;
+
+    if (context == NULL || context->is_initialized == 0 || context->allocator.allocate == NULL)
+        return;
+
+    /* Free every block from the one in use back to the first */
+    block = context->buffer - sizeof(hoxml_block_t);
+    while (block != NULL) {
+        char* previous = ((hoxml_block_t*)block)->previous;
+
+        context->allocator.release(block, context->allocator.user);
+        block = previous;
+    }
+    if (context->spare_block != NULL)
+        context->allocator.release(context->spare_block, context->allocator.user);
+    memset(context, 0, sizeof(hoxml_context_t));
 }
 
 HOXML_DECL void hoxml_realloc(hoxml_context_t* context, void* buffer, size_t buffer_length) {
-    hoxml_node_t* node;
+    size_t live_length;
 
-    if (context == NULL || context->is_initialized == 0 || buffer == NULL || buffer_length <= context->buffer_length)
+    if (context == NULL || context->is_initialized == 0 || buffer == NULL || buffer_length <= context->buffer_length ||
+            context->allocator.allocate != NULL)
         return;
 
-    /* Reassign the end and parent pointers of each node, beginning at the tail and iterate to the head */
-    node = HOXML_STACK;
-    while (node != NULL) {
-        hoxml_node_t* parent = node->parent;
-        node->end = (char*)buffer + (node->end - context->buffer);
-        if (node->parent != NULL)
-            node->parent = (hoxml_node_t*)((char*)buffer + ((char*)node->parent - context->buffer));
-        node = parent;
+    /* Only the stack, up to the head node's end and the terminator that may follow it, is copied to the new buffer. */
+    /* It's measured before the stack is reassigned to the new buffer, where the head node hasn't been copied yet. */
+    live_length = 0;
+    if (context->stack != NULL) {
+        live_length = HOXML_END(HOXML_STACK) + 1 - context->buffer + 2;
+        if (live_length > context->buffer_length)
+            live_length = context->buffer_length;
     }
 
-    /* Use offsets from the original buffer pointer to reassign pointers such that they now point to the new buffer */
+    /* Nodes only hold offsets so the stack is copied as it is. Use offsets from the original buffer pointer to */
+    /* reassign pointers such that they now point to the new buffer. */
     if (context->tag != NULL)
         context->tag = (char*)buffer + (context->tag - context->buffer);
     if (context->attribute != NULL)
@@ -327,15 +1087,22 @@ HOXML_DECL void hoxml_realloc(hoxml_context_t* context, void* buffer, size_t buf
         context->value = (char*)buffer + (context->value - context->buffer);
     if (context->content != NULL)
         context->content = (char*)buffer + (context->content - context->buffer);
-    if (context->reference_start != NULL)
-        context->reference_start = (char*)buffer + (context->reference_start - context->buffer);
     if (context->stack != NULL)
         context->stack = (char*)buffer + (context->stack - context->buffer);
+    /* Views may point into either the XML content or the buffer. Only the latter need to be reassigned. */
+    #define HOXML_REBASE_VIEW(v) if (v.data >= context->buffer && v.data < context->buffer + context->buffer_length) \
+        v.data = (char*)buffer + (v.data - context->buffer);
+    HOXML_REBASE_VIEW(context->tag_view)
+    HOXML_REBASE_VIEW(context->attribute_view)
+    HOXML_REBASE_VIEW(context->value_view)
+    HOXML_REBASE_VIEW(context->content_view)
+    #undef HOXML_REBASE_VIEW
 
-    memset(buffer, 0, buffer_length); /* Fill the new buffer with zeroes */
-    memcpy(buffer, context->buffer, context->buffer_length); /* Copy the entire, current buffer to the new buffer */
+    memcpy(buffer, context->buffer, live_length);
     context->buffer = (char*)buffer;
     context->buffer_length = buffer_length;
+    if (context->buffer_length > UINT32_MAX)
+        context->buffer_length = UINT32_MAX;
 
     if (context->state == HOXML_STATE_ERROR_INSUFFICIENT_MEMORY) {
         context->state = context->error_return_state;
@@ -344,23 +1111,14 @@ HOXML_DECL void hoxml_realloc(hoxml_context_t* context, void* buffer, size_t buf
 }
 
 HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, const size_t xml_length) {
-    const char* previous_iterator;
-    size_t previous_stream_length;
+    hoxml_code_t code;
 
     if (context == NULL || context->is_initialized == 0 || xml == NULL || xml_length == 0)
         return HOXML_ERROR_INVALID_INPUT;
 
-    if (HOXML_STACK != NULL) {
-        if (HOXML_STACK->flags & HOXML_FLAG_INCREMENT_DEPTH) { /* If an element began, increasing nesting */
-            context->depth += 1;
-            HOXML_STACK->flags &= ~HOXML_FLAG_INCREMENT_DEPTH; /* Clear the flag */
-        }
-
-        if (HOXML_STACK->flags & HOXML_FLAG_DECREMENT_DEPTH) { /* If an element ended, decreasing nesting */
-            context->depth -= 1;
-            HOXML_STACK->flags &= ~HOXML_FLAG_DECREMENT_DEPTH; /* Clear the flag */
-        }
-    }
+    /* If an element began or ended when hoxml_parse() last returned, the nesting changed */
+    context->depth += context->depth_change;
+    context->depth_change = 0;
 
     switch (context->state) {
         /* Two errors are recoverable: HOXML_ERROR_INSUFFICIENT_MEMORY and HOXML_ERROR_UNEXPECTED_EOF. The former can */
@@ -374,29 +1132,33 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             /* Try to decode a character, or remainder of a character, at the beginning of this hopefully-new string */
             stream = context->stream;
             /* Calculate the number of bytes to copy into the 'stream' variable from the hopefully-new string. We */
-            /* want 4 bytes, or whatever is available. */
-            bytes_to_copy = 4;
+            /* want 4 bytes, including any carried over from a previous string, or whatever is available. */
+            bytes_to_copy = 4 - context->stream_length;
             if (bytes_to_copy > xml_length)
                 bytes_to_copy = xml_length;
-            if (context->stream_length > 0) {
-                /* Adjust the number of bytes to copy to account for possible bytes from a previous string */
-                bytes_to_copy -= context->stream_length;
-                /* Append the new bytes to the previous one(s) */
-                memcpy((char*)&stream + context->stream_length, xml, bytes_to_copy);
-            }
-            else {
-                /* Copy to the 'stream' under the assumption that all of it can be overwritten */
-                memcpy(&stream, xml, bytes_to_copy);
-            }
-            c = hoxml_decode_character((const char*)&stream, xml_length, context->encoding);
+            /* Append the new bytes to the previous one(s), if any */
+            memcpy((char*)&stream + context->stream_length, xml, bytes_to_copy);
+            c = hoxml_decode_character((const char*)&stream, context->stream_length + bytes_to_copy,
+                context->encoding);
             /* If the character is the equivalent of a null terminator or there was not enough data */
-            if (c.codepoint == 0 || c.codepoint == UINT32_MAX)
+            if (c.codepoint == 0)
+                return HOXML_ERROR_UNEXPECTED_EOF;
+            else if (c.codepoint == UINT32_MAX) {
+                /* The whole string is yet another part of a single character. Keep its bytes for the next string. */
+                context->stream = stream;
+                context->stream_length += bytes_to_copy;
                 return HOXML_ERROR_UNEXPECTED_EOF;
+            }
             context->state = context->error_return_state;
             context->error_return_state = HOXML_STATE_NONE;
-            /* Note: there is a check for a change in the input pointer a little further down */
+            /* The string is the continuation of the content, even if its pointer is the same as the last string's */
+            context->xml = NULL;
         } break;
-        case HOXML_STATE_DONE: return HOXML_END_OF_DOCUMENT;
+        case HOXML_STATE_DONE:
+            if (!(context->options & HOXML_OPTION_STREAM))
+                return HOXML_END_OF_DOCUMENT;
+            hoxml_begin_document(context); /* With streams, another document follows the one that ended */
+            break;
         case HOXML_STATE_ERROR_INTERNAL: return HOXML_ERROR_INTERNAL;
         case HOXML_STATE_ERROR_INSUFFICIENT_MEMORY: return HOXML_ERROR_INSUFFICIENT_MEMORY;
         case HOXML_STATE_ERROR_SYNTAX: return HOXML_ERROR_SYNTAX;
@@ -416,59 +1178,765 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
         context->xml = xml;
         context->xml_length = xml_length;
         context->iterator = xml;
+        /* With lazy positions, the characters in the previous string were counted before it ran out */
+        if (context->options & HOXML_OPTION_LAZY_POSITION)
+            context->position = xml;
     }
 
-    /* Remember some context variables in case we hit an unexpected EoF and need to undo an iteration */
-    previous_iterator = context->iterator;
-    previous_stream_length = context->stream_length;
-    while (context->state >= HOXML_STATE_NONE && context->state <= HOXML_STATE_DONE) {
-        size_t bytes_remaining, bytes_to_copy;
-        hoxml_character_t c;
+    /* With hoxml_parse_budget(), parsing stops where the budget runs out unless the content ends first */
+    context->budget_end = NULL;
+    if (context->budget > 0 && context->budget < context->xml_length - (size_t)(context->iterator - context->xml))
+        context->budget_end = context->iterator + context->budget;
 
-        /* About half of the parsing states assume the stack is non-null. */
-        /* If parsing is currently in one of those states and the stack (head) pointer is null. */
-        if (((context->state >= HOXML_STATE_TAG_BEGIN && context->state <= HOXML_STATE_OPEN_TAG) ||
-                (context->state >= HOXML_STATE_REFERENCE_BEGIN && context->state <= HOXML_STATE_REFERENCE_HEX)) &&
-                context->stack == NULL) {
-            /* Some unforseen bug has led us to a state in which continuing would cause an illegal memory access. */
-            /* Parsing must halt. There is no way to recover. */
-            context->state = HOXML_STATE_ERROR_INTERNAL;
-            return HOXML_ERROR_INTERNAL;
-        }
+    /* A fragment is parsed as if within an element, whose open tag was never seen, from the start */
+    if (context->options & HOXML_OPTION_FRAGMENT && context->state == HOXML_STATE_NONE && context->stack == NULL &&
+            context->encoding == HOXML_ENC_UNKNOWN) {
+        hoxml_begin_fragment(context);
+        if (context->state == HOXML_STATE_ERROR_INSUFFICIENT_MEMORY)
+            return HOXML_ERROR_INSUFFICIENT_MEMORY;
+    }
 
-        /* Calculate the number of bytes remaining in the current XML content string */
-        bytes_remaining = (size_t)(context->xml_length - (context->iterator - context->xml));
-        /* Calculate the number of bytes to copy into the 'stream' variable. We want 4 bytes, or whatever is left. */
-        bytes_to_copy = 4;
-        if (bytes_to_copy > bytes_remaining)
-            bytes_to_copy = bytes_remaining;
-        if (context->stream_length > 0) {
-            /* Adjust the number of bytes to copy to account for possible bytes from a previous XML content string. */
-            /* This will be non-zero in the rare case where content is being given in parts. */
-            bytes_to_copy -= context->stream_length;
-            /* Append the new bytes to the previous one(s) */
-            memcpy((char*)&(context->stream) + context->stream_length, context->iterator, bytes_to_copy);
-        }
-        else {
-            /* Copy to the 'stream' under the assumption that all of it can be overwritten */
-            memcpy(&(context->stream), context->iterator, bytes_to_copy);
-        }
-        c = hoxml_decode_character((const char*)&(context->stream), bytes_remaining, context->encoding);
+    code = hoxml_run(context);
+    if (code <= HOXML_END_OF_DOCUMENT) /* With lazy positions, errors and the document's end are where they're found */
+        hoxml_count_position(context);
+    if (code == HOXML_YIELD) /* Parsing stopped between codes so there's nothing new to present */
+        return code;
+    if (code > HOXML_END_OF_DOCUMENT)
+        hoxml_set_lengths(context);
+    if (code > HOXML_END_OF_DOCUMENT && context->options & HOXML_OPTION_VIEWS)
+        hoxml_set_views(context);
+    if (code > HOXML_END_OF_DOCUMENT && context->symbols != NULL)
+        context->tag_id = context->tag != NULL ? HOXML_NODE_ID(HOXML_NODE_OF(context->tag)) : HOXML_SYMBOL_NONE;
+    return code;
+}
 
-        /* If the character is the equivalent of a null terminator or there was not enough data to decode the value */
-        if (c.codepoint == 0 || c.codepoint == UINT32_MAX) {
-            context->stream_length = bytes_to_copy;
-            context->error_return_state = context->state;
-            context->state = HOXML_STATE_ERROR_UNEXPECTED_EOF;
-            return HOXML_ERROR_UNEXPECTED_EOF;
-        } else if (HOXML_IS_NEW_LINE(c.codepoint)) {
-            if (context->newline_character == 0) /* If this is the first newline */
-                context->newline_character = c.codepoint; /* Remember this as the character to use for increments */
-            if (c.codepoint == context->newline_character) /* Avoid incrementing twice for files with \r\n endings */
-                context->line++;
-            context->column = 0;
+HOXML_DECL hoxml_code_t hoxml_parse_budget(hoxml_context_t* context, const char* xml, size_t xml_length,
+        size_t max_bytes) {
+    hoxml_code_t code;
+
+    if (context == NULL || max_bytes == 0)
+        return HOXML_ERROR_INVALID_INPUT;
+
+    context->budget = max_bytes;
+    code = hoxml_parse(context, xml, xml_length);
+    /* The budget only applies to this call */
+    context->budget = 0;
+    context->budget_end = NULL;
+    return code;
+}
+
+HOXML_DECL void hoxml_position(hoxml_context_t* context) {
+    if (context == NULL || context->is_initialized == 0)
+        return;
+
+    hoxml_count_position(context);
+}
+
+HOXML_DECL hoxml_code_t hoxml_parse_sax(hoxml_context_t* context, const char* xml, size_t xml_length,
+        const hoxml_sax_t* sax, void* user) {
+    hoxml_code_t code;
+
+    if (sax == NULL)
+        return HOXML_ERROR_INVALID_INPUT;
+
+    /* The first call checks for errors and recovers from them, cleans up, and takes the XML content string */
+    code = hoxml_parse(context, xml, xml_length);
+    while (code > HOXML_END_OF_DOCUMENT) {
+        switch (code) {
+        case HOXML_ELEMENT_BEGIN:
+            if (sax->element_begin != NULL)
+                sax->element_begin(context, user);
+            break;
+        case HOXML_ELEMENT_END:
+            if (sax->element_end != NULL)
+                sax->element_end(context, user);
+            break;
+        case HOXML_ATTRIBUTE:
+            if (sax->attribute != NULL)
+                sax->attribute(context, user);
+            break;
+        case HOXML_PROCESSING_INSTRUCTION_BEGIN:
+            if (sax->processing_instruction_begin != NULL)
+                sax->processing_instruction_begin(context, user);
+            break;
+        case HOXML_PROCESSING_INSTRUCTION_END:
+            if (sax->processing_instruction_end != NULL)
+                sax->processing_instruction_end(context, user);
+            break;
+        case HOXML_TEXT:
+            if (sax->text != NULL)
+                sax->text(context, user);
+            break;
+        default: break;
+        }
+
+        /* Continue without returning. The state can't be an error here and the XML content string is the same so */
+        /* only what hoxml_parse() does after returning a code is needed. */
+        context->depth += context->depth_change;
+        context->depth_change = 0;
+        if (hoxml_post_state_cleanup(context)) /* If the cleanup process found the document ended */
+            return HOXML_END_OF_DOCUMENT;
+        code = hoxml_run(context);
+        if (code <= HOXML_END_OF_DOCUMENT)
+            hoxml_count_position(context);
+        if (code > HOXML_END_OF_DOCUMENT)
+            hoxml_set_lengths(context);
+        if (code > HOXML_END_OF_DOCUMENT && context->options & HOXML_OPTION_VIEWS)
+            hoxml_set_views(context);
+        if (code > HOXML_END_OF_DOCUMENT && context->symbols != NULL)
+            context->tag_id = context->tag != NULL ? HOXML_NODE_ID(HOXML_NODE_OF(context->tag)) : HOXML_SYMBOL_NONE;
+    }
+
+    /* Errors that the caller can recover from are only returned, like hoxml_parse() */
+    if (code < HOXML_END_OF_DOCUMENT && code != HOXML_ERROR_UNEXPECTED_EOF &&
+            code != HOXML_ERROR_INSUFFICIENT_MEMORY && sax->error != NULL)
+        sax->error(context, code, user);
+    return code;
+}
+
+HOXML_DECL int hoxml_skip_element(hoxml_context_t* context) {
+    if (context == NULL || context->is_initialized == 0 || context->stack == NULL ||
+            context->post_state == HOXML_POST_STATE_TAG_END)
+        return 0;
+
+    if (context->state == HOXML_STATE_ELEMENT_NAME1 && HOXML_STACK->flags & HOXML_FLAG_EMPTY_ELEMENT)
+        return 1; /* The element is empty (e.g. "<tag/") so its end is next anyway */
+    else if (context->state == HOXML_STATE_ELEMENT_NAME2 && HOXML_STACK->flags & HOXML_FLAG_BEGUN) {
+        context->state = HOXML_STATE_SKIP_TAG; /* The rest of the open tag (e.g. "<tag attr='value'") is skipped too */
+        context->skip_depth = -1;
+    } else if (context->state == HOXML_STATE_OPEN_TAG) {
+        context->state = HOXML_STATE_SKIP_CONTENT;
+        context->skip_depth = 0;
+    } else
+        return 0;
+    /* Content found so far isn't kept so any view of it is forgotten rather than copied */
+    context->view = NULL;
+    context->view_length = 0;
+    HOXML_STACK->flags &= ~HOXML_FLAG_VIEW;
+    return 1;
+}
+
+HOXML_DECL size_t hoxml_split(const char* xml, size_t xml_length, size_t* offsets, size_t max_parts) {
+    size_t i, parts, boundary;
+    int depth;
+
+    if (xml == NULL || offsets == NULL || max_parts == 0)
+        return 0;
+
+    offsets[0] = 0;
+    parts = 1;
+    /* Fragments are parsed as UTF-8 so UTF-16 content, marked by its byte order mark, is left whole */
+    if (xml_length >= 2 && (((unsigned char)xml[0] == 0xFE && (unsigned char)xml[1] == 0xFF) ||
+            ((unsigned char)xml[0] == 0xFF && (unsigned char)xml[1] == 0xFE)))
+        return 1;
+
+    depth = 0;
+    i = boundary = 0;
+    while (i < xml_length) {
+        const char* markup = (const char*)memchr(xml + i, '<', xml_length - i);
+
+        if (markup == NULL)
+            break;
+        i = (size_t)(markup - xml);
+        if (i + 1 >= xml_length)
+            break;
+        if (xml[i + 1] == '!') {
+            if (xml_length - i >= 4 && memcmp(xml + i, "<!--", 4) == 0)
+                i = hoxml_split_find(xml, xml_length, i + 4, "-->");
+            else if (xml_length - i >= 9 && memcmp(xml + i, "<![CDATA[", 9) == 0)
+                i = hoxml_split_find(xml, xml_length, i + 9, "]]>");
+            else /* A document type declaration (e.g. "<!DOCTYPE root [...]>") */
+                i = hoxml_split_tag(xml, xml_length, i);
+        } else if (xml[i + 1] == '?')
+            i = hoxml_split_find(xml, xml_length, i + 2, "?>");
+        else if (xml[i + 1] == '/') {
+            i = hoxml_split_tag(xml, xml_length, i);
+            if (--depth <= 0) /* If the root element closed, there's nothing left to split */
+                break;
+            boundary = depth == 1 ? i : boundary;
+        } else {
+            /* Once the current part is long enough, the next begins after the last of the root's children, or its */
+            /* open tag, so text before this child is in the same part. Text is returned when an element begins or */
+            /* ends so no text is left unreturned at the end of a part. */
+            if (depth == 1 && parts < max_parts && i >= parts * (xml_length / max_parts))
+                offsets[parts++] = boundary;
+            i = hoxml_split_tag(xml, xml_length, i);
+            if (i < 2 || xml[i - 2] != '/') /* Unless it was an empty element (e.g. "<tag/>") */
+                depth++;
+            boundary = depth == 1 ? i : boundary;
+        }
+    }
+
+    return parts;
+}
+
+HOXML_DECL int hoxml_symbols_init(hoxml_symbols_t* symbols, const char* const* names, size_t name_count, int* slots,
+        size_t slot_count) {
+    size_t i;
+
+    /* The slot count must be a power of two, so hashes can be masked, and leave at least one slot empty */
+    if (symbols == NULL || (names == NULL && name_count > 0) || slots == NULL || slot_count <= name_count ||
+            (slot_count & (slot_count - 1)) != 0 || name_count > HOXML_MAX_SYMBOLS)
+        return 0;
+
+    symbols->names = names;
+    symbols->name_count = name_count;
+    symbols->slots = slots;
+    symbols->slot_count = slot_count;
+    for (i = 0; i < slot_count; i++)
+        slots[i] = HOXML_SYMBOL_NONE;
+    for (i = 0; i < name_count; i++) {
+        unsigned long hash;
+        const char* it;
+
+        /* Hash the name the same way names are hashed while parsing, by codepoint */
+        hash = HOXML_HASH_BASIS;
+        for (it = names[i]; *it != '\0';) {
+            hoxml_character_t c = hoxml_decode_character(it, 4, HOXML_ENC_UTF_8);
+
+            if (c.bytes == 0) /* If the name isn't valid UTF-8 */
+                return 0;
+            hash = HOXML_HASH(hash, c.codepoint);
+            it += c.bytes;
+        }
+        /* Probe linearly from the hash's slot to the first empty one */
+        hash &= slot_count - 1;
+        while (slots[hash] != HOXML_SYMBOL_NONE)
+            hash = (hash + 1) & (slot_count - 1);
+        slots[hash] = (int)i;
+    }
+
+    return 1;
+}
+
+HOXML_DECL int hoxml_bind_attribute(const hoxml_context_t* context, const hoxml_binding_t* bindings,
+        size_t binding_count, void* object) {
+    const hoxml_binding_t* binding;
+    size_t i;
+
+    if (context == NULL || bindings == NULL || object == NULL || context->attribute_id == HOXML_SYMBOL_NONE)
+        return 0;
+
+    binding = NULL;
+    for (i = 0; i < binding_count && binding == NULL; i++) {
+        if (bindings[i].attribute_id == context->attribute_id &&
+                (bindings[i].tag_id == HOXML_SYMBOL_NONE || bindings[i].tag_id == context->tag_id))
+            binding = &(bindings[i]);
+    }
+    if (binding == NULL)
+        return 0;
+
+    return hoxml_convert(context, 0, binding->type, binding->values, (char*)object + binding->offset) ? 1 : -1;
+}
+
+HOXML_DECL int hoxml_value_as_long(const hoxml_context_t* context, long* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 0, HOXML_BIND_LONG, NULL, value);
+}
+
+HOXML_DECL int hoxml_value_as_unsigned_long(const hoxml_context_t* context, unsigned long* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 0, HOXML_BIND_UNSIGNED_LONG, NULL, value);
+}
+
+HOXML_DECL int hoxml_value_as_double(const hoxml_context_t* context, double* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 0, HOXML_BIND_DOUBLE, NULL, value);
+}
+
+HOXML_DECL int hoxml_value_as_bool(const hoxml_context_t* context, int* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 0, HOXML_BIND_BOOL, NULL, value);
+}
+
+HOXML_DECL int hoxml_content_as_long(const hoxml_context_t* context, long* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 1, HOXML_BIND_LONG, NULL, value);
+}
+
+HOXML_DECL int hoxml_content_as_unsigned_long(const hoxml_context_t* context, unsigned long* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 1, HOXML_BIND_UNSIGNED_LONG, NULL, value);
+}
+
+HOXML_DECL int hoxml_content_as_double(const hoxml_context_t* context, double* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 1, HOXML_BIND_DOUBLE, NULL, value);
+}
+
+HOXML_DECL int hoxml_content_as_bool(const hoxml_context_t* context, int* value) {
+    return context != NULL && value != NULL && hoxml_convert(context, 1, HOXML_BIND_BOOL, NULL, value);
+}
+
+HOXML_DECL void hoxml_decoder_init(hoxml_decoder_t* decoder, int format, unsigned long* values, size_t max_values) {
+    if (decoder == NULL)
+        return;
+
+    memset(decoder, 0, sizeof(hoxml_decoder_t));
+    decoder->format = format;
+    decoder->values = values;
+    decoder->max_values = max_values;
+    decoder->is_error = values == NULL || (format != HOXML_DATA_CSV && format != HOXML_DATA_BASE64);
+}
+
+HOXML_DECL int hoxml_decoder_decode(hoxml_decoder_t* decoder, const hoxml_context_t* context) {
+    const char* str;
+    size_t length;
+    int encoding;
+
+    if (decoder == NULL || context == NULL)
+        return 0;
+
+    str = context->options & HOXML_OPTION_VIEWS ? context->content_view.data : context->content;
+    length = context->content_length;
+    encoding = context->string_encoding == HOXML_ENC_UNKNOWN ? HOXML_ENC_UTF_8 : context->string_encoding;
+    if (str != NULL && !decoder->is_error) {
+        if (decoder->format == HOXML_DATA_CSV)
+            hoxml_decode_csv(decoder, str, length, encoding);
+        else
+            hoxml_decode_base64(decoder, str, length, encoding);
+    }
+
+    return !decoder->is_error;
+}
+
+HOXML_DECL int hoxml_decoder_finish(hoxml_decoder_t* decoder) {
+    if (decoder == NULL)
+        return 0;
+
+    if (decoder->is_error)
+        return 0;
+    if (decoder->format == HOXML_DATA_CSV) {
+        if (decoder->value_length > 0) /* The last integer isn't followed by a comma */
+            hoxml_store_value(decoder);
+        else if (decoder->is_separated) /* But a comma must be followed by an integer */
+            decoder->is_error = 1;
+    } else {
+        /* Without padding, the last group of characters may be short. Only whole integers are acceptable. */
+        if (!decoder->is_ended && decoder->bit_count > 6)
+            hoxml_end_base64(decoder);
+        if (decoder->padding != 0 || decoder->bit_count != 0 || decoder->value_length != 0)
+            decoder->is_error = 1;
+    }
+
+    return !decoder->is_error;
+}
+
+#ifdef HOXML_ENABLE_FILE
+HOXML_DECL int hoxml_file_open(hoxml_file_t* file, const char* path) {
+    if (file == NULL || path == NULL)
+        return 0;
+
+    memset(file, 0, sizeof(hoxml_file_t));
+#if defined(HOXML_FILE_POSIX)
+    { /* Map the file to memory and let the system read it as it's accessed */
+        int descriptor;
+        struct stat status;
+        void* map;
+
+        if ((descriptor = open(path, O_RDONLY)) != -1) {
+            if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+                map = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (map != MAP_FAILED) {
+                    /* The file will be read from beginning to end, once, so the system can read well ahead */
+                    #if defined(MADV_SEQUENTIAL)
+                        madvise(map, (size_t)status.st_size, MADV_SEQUENTIAL);
+                    #elif defined(POSIX_MADV_SEQUENTIAL)
+                        posix_madvise(map, (size_t)status.st_size, POSIX_MADV_SEQUENTIAL);
+                    #endif
+                    file->xml = (const char*)map;
+                    file->xml_length = (size_t)status.st_size;
+                    file->is_mapped = 1;
+                }
+            }
+            close(descriptor); /* The mapping remains valid after the file is closed */
+        }
+    }
+#elif defined(HOXML_FILE_WIN32)
+    { /* Map the file to memory and let the system read it as it's accessed */
+        HANDLE handle, mapping;
+        LARGE_INTEGER size;
+
+        handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+        if (handle != INVALID_HANDLE_VALUE) {
+            if (GetFileSizeEx(handle, &size) && size.QuadPart > 0 &&
+                    (mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL) {
+                file->xml = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (file->xml != NULL) {
+                    file->xml_length = (size_t)size.QuadPart;
+                    file->is_mapped = 1;
+                }
+                CloseHandle(mapping); /* The view remains valid after the mapping is closed */
+            }
+            CloseHandle(handle);
+        }
+    }
+#endif
+    if (file->xml == NULL) { /* If the file couldn't be mapped to memory, read it into memory instead */
+        FILE* stream;
+        long length;
+        char* xml;
+
+        if ((stream = fopen(path, "rb")) == NULL)
+            return 0;
+        if (fseek(stream, 0, SEEK_END) == 0 && (length = ftell(stream)) > 0 && fseek(stream, 0, SEEK_SET) == 0 &&
+                (xml = (char*)malloc((size_t)length)) != NULL) {
+            if (fread(xml, 1, (size_t)length, stream) == (size_t)length) {
+                file->xml = xml;
+                file->xml_length = (size_t)length;
+            } else
+                free(xml);
+        }
+        fclose(stream);
+        if (file->xml == NULL)
+            return 0;
+    }
+
+    file->buffer_length = HOXML_FILE_BUFFER_LENGTH;
+    if ((file->buffer = malloc(file->buffer_length)) == NULL) {
+        hoxml_file_close(file);
+        return 0;
+    }
+    hoxml_init(&(file->context), file->buffer, file->buffer_length);
+    return 1;
+}
+
+HOXML_DECL hoxml_code_t hoxml_file_parse(hoxml_file_t* file) {
+    hoxml_code_t code;
+
+    if (file == NULL || file->xml == NULL)
+        return HOXML_ERROR_INVALID_INPUT;
+
+    /* The whole file is one XML content string so running out of memory is the only error to recover from here */
+    while ((code = hoxml_parse(&(file->context), file->xml, file->xml_length)) == HOXML_ERROR_INSUFFICIENT_MEMORY &&
+            hoxml_file_grow(file)) ;
+    return code;
+}
+
+HOXML_DECL hoxml_code_t hoxml_file_parse_sax(hoxml_file_t* file, const hoxml_sax_t* sax, void* user) {
+    hoxml_code_t code;
+
+    if (file == NULL || file->xml == NULL)
+        return HOXML_ERROR_INVALID_INPUT;
+
+    while ((code = hoxml_parse_sax(&(file->context), file->xml, file->xml_length, sax, user)) ==
+            HOXML_ERROR_INSUFFICIENT_MEMORY && hoxml_file_grow(file)) ;
+    return code;
+}
+
+HOXML_DECL void hoxml_file_close(hoxml_file_t* file) {
+    if (file == NULL)
+        return;
+
+    if (file->xml != NULL) {
+        if (file->is_mapped) {
+#if defined(HOXML_FILE_POSIX)
+            munmap((void*)file->xml, file->xml_length);
+#elif defined(HOXML_FILE_WIN32)
+            UnmapViewOfFile(file->xml);
+#endif
         } else
-            context->column++;
+            free((void*)file->xml);
+    }
+    free(file->buffer);
+    memset(file, 0, sizeof(hoxml_file_t));
+}
+
+/* Double the length of a file object's buffer. Returns 1 if successful or 0 if the memory couldn't be allocated or */
+/* the buffer already has all 4 GB that can be used. */
+int hoxml_file_grow(hoxml_file_t* file) {
+    void* buffer;
+
+    if (file->context.buffer_length >= UINT32_MAX || (buffer = malloc(file->buffer_length * 2)) == NULL)
+        return 0;
+    hoxml_realloc(&(file->context), buffer, file->buffer_length * 2);
+    free(file->buffer);
+    file->buffer = buffer;
+    file->buffer_length *= 2;
+    return 1;
+}
+#endif /* HOXML_ENABLE_FILE */
+
+#ifdef HOXML_ENABLE_INDEX
+HOXML_DECL hoxml_code_t hoxml_index_build(hoxml_index_t* index, const char* xml, size_t xml_length, int options) {
+    hoxml_context_t context;
+    hoxml_code_t code;
+    void* buffer;
+    size_t buffer_length, open_entry;
+
+    if (index == NULL || xml == NULL)
+        return HOXML_ERROR_INVALID_INPUT;
+
+    memset(index, 0, sizeof(hoxml_index_t));
+    index->xml = xml;
+    index->xml_length = xml_length;
+    buffer_length = HOXML_INDEX_BUFFER_LENGTH;
+    if ((buffer = malloc(buffer_length)) == NULL)
+        return HOXML_ERROR_INSUFFICIENT_MEMORY;
+    hoxml_init(&context, buffer, buffer_length);
+    /* Strings are recorded from views so that those in the XML content are never copied */
+    context.options = (options & ~HOXML_OPTION_TEXT) | HOXML_OPTION_VIEWS;
+
+    open_entry = HOXML_INDEX_NONE; /* No element or PI has begun yet */
+    while ((code = hoxml_parse(&context, xml, xml_length)) != HOXML_END_OF_DOCUMENT) {
+        if (code == HOXML_ERROR_INSUFFICIENT_MEMORY) { /* Double the buffer and continue */
+            void* new_buffer;
+
+            if (context.buffer_length >= UINT32_MAX || (new_buffer = malloc(buffer_length * 2)) == NULL)
+                break; /* A longer buffer than 4 GB wouldn't be used */
+            hoxml_realloc(&context, new_buffer, buffer_length * 2);
+            free(buffer);
+            buffer = new_buffer;
+            buffer_length *= 2;
+        } else if (code < HOXML_END_OF_DOCUMENT)
+            break;
+        else if (hoxml_index_add(index, &context, code, &open_entry) == 0) {
+            code = HOXML_ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+    }
+
+    index->line = context.line;
+    index->column = context.column;
+    free(buffer);
+    return code;
+}
+
+HOXML_DECL hoxml_view_t hoxml_index_name(const hoxml_index_t* index, size_t entry) {
+    hoxml_view_t view;
+    const hoxml_index_entry_t* e;
+
+    view.data = NULL;
+    view.length = 0;
+    if (index == NULL || entry >= index->entry_count)
+        return view;
+
+    e = &(index->entries[entry]);
+    view.data = (e->flags & HOXML_INDEX_NAME_COPIED ? index->strings : index->xml) + e->name;
+    view.length = e->name_length;
+    return view;
+}
+
+HOXML_DECL hoxml_view_t hoxml_index_value(const hoxml_index_t* index, size_t entry) {
+    hoxml_view_t view;
+    const hoxml_index_entry_t* e;
+
+    view.data = NULL;
+    view.length = 0;
+    if (index == NULL || entry >= index->entry_count || !(index->entries[entry].flags & HOXML_INDEX_HAS_VALUE))
+        return view;
+
+    e = &(index->entries[entry]);
+    view.data = (e->flags & HOXML_INDEX_VALUE_COPIED ? index->strings : index->xml) + e->value;
+    view.length = e->value_length;
+    return view;
+}
+
+HOXML_DECL void hoxml_index_free(hoxml_index_t* index) {
+    if (index == NULL)
+        return;
+
+    free(index->entries);
+    free(index->strings);
+    memset(index, 0, sizeof(hoxml_index_t));
+}
+
+/* Record the code just returned by hoxml_parse() as a new entry. The 'open_entry' variable is the index of the */
+/* innermost element or PI that hasn't ended, or HOXML_INDEX_NONE. Until they end, each of those entries' 'end' */
+/* variable holds the index of the one enclosing it. Returns 1 if successful or 0 if memory couldn't be allocated. */
+int hoxml_index_add(hoxml_index_t* index, hoxml_context_t* context, hoxml_code_t code, size_t* open_entry) {
+    hoxml_index_entry_t* entry;
+    size_t entry_index;
+    int is_copied;
+
+    if (index->entry_count == index->entry_capacity) { /* If there's no room for another entry, double the room */
+        hoxml_index_entry_t* entries;
+        size_t capacity;
+
+        capacity = index->entry_capacity == 0 ? 64 : index->entry_capacity * 2;
+        entries = (hoxml_index_entry_t*)realloc(index->entries, capacity * sizeof(hoxml_index_entry_t));
+        if (entries == NULL)
+            return 0;
+        index->entries = entries;
+        index->entry_capacity = capacity;
+    }
+
+    entry_index = index->entry_count;
+    entry = &(index->entries[entry_index]);
+    memset(entry, 0, sizeof(hoxml_index_entry_t));
+    entry->code = code;
+    entry->depth = context->depth;
+    entry->end = entry_index;
+    switch (code) {
+    case HOXML_ELEMENT_BEGIN:
+    case HOXML_PROCESSING_INSTRUCTION_BEGIN:
+        if (!hoxml_index_store(index, context->tag_view, &(entry->name), &(entry->name_length), &is_copied))
+            return 0;
+        entry->flags = is_copied ? HOXML_INDEX_NAME_COPIED : 0;
+        entry->end = *open_entry; /* Remember the enclosing element until this one ends */
+        *open_entry = entry_index;
+        break;
+    case HOXML_ATTRIBUTE: /* The attribute's element is the one that began most recently */
+        if (!hoxml_index_store(index, context->attribute_view, &(entry->name), &(entry->name_length), &is_copied))
+            return 0;
+        entry->flags = is_copied ? HOXML_INDEX_NAME_COPIED : 0;
+        if (!hoxml_index_store(index, context->value_view, &(entry->value), &(entry->value_length), &is_copied))
+            return 0;
+        entry->flags |= HOXML_INDEX_HAS_VALUE | (is_copied ? HOXML_INDEX_VALUE_COPIED : 0);
+        break;
+    default: /* HOXML_ELEMENT_END or HOXML_PROCESSING_INSTRUCTION_END */
+        if (*open_entry != HOXML_INDEX_NONE) { /* Link the entry that began the element or PI to this one */
+            hoxml_index_entry_t* begin = &(index->entries[*open_entry]);
+
+            *open_entry = begin->end;
+            begin->end = entry_index;
+            /* The name is the same as the beginning's so there's no need to store it again */
+            entry->name = begin->name;
+            entry->name_length = begin->name_length;
+            entry->flags = begin->flags & HOXML_INDEX_NAME_COPIED;
+        }
+        if (context->content_view.data != NULL) { /* If there's content */
+            if (!hoxml_index_store(index, context->content_view, &(entry->value), &(entry->value_length),
+                    &is_copied))
+                return 0;
+            entry->flags |= HOXML_INDEX_HAS_VALUE | (is_copied ? HOXML_INDEX_VALUE_COPIED : 0);
+        }
+        break;
+    }
+
+    index->entry_count++;
+    return 1;
+}
+
+/* Record a string as an offset and length. A string that's a view into the XML content is recorded as it is while */
+/* any other string is copied to the end of the index's strings, and 'is_copied' is set to match. Returns 1 if */
+/* successful or 0 if memory couldn't be allocated. */
+int hoxml_index_store(hoxml_index_t* index, hoxml_view_t view, size_t* offset, size_t* length, int* is_copied) {
+    *length = view.length;
+    if (view.data >= index->xml && view.data + view.length <= index->xml + index->xml_length) {
+        *offset = (size_t)(view.data - index->xml);
+        *is_copied = 0;
+        return 1;
+    }
+
+    if (index->strings_length + view.length > index->strings_capacity) { /* If there's no room, at least double it */
+        char* strings;
+        size_t capacity;
+
+        capacity = index->strings_capacity == 0 ? 256 : index->strings_capacity * 2;
+        while (capacity < index->strings_length + view.length)
+            capacity *= 2;
+        if ((strings = (char*)realloc(index->strings, capacity)) == NULL)
+            return 0;
+        index->strings = strings;
+        index->strings_capacity = capacity;
+    }
+    *offset = index->strings_length;
+    if (view.length > 0)
+        memcpy(index->strings + index->strings_length, view.data, view.length);
+    index->strings_length += view.length;
+    *is_copied = 1;
+    return 1;
+}
+#endif /* HOXML_ENABLE_INDEX */
+
+/* Run the state machine, one character at a time, until there's a code to return */
+hoxml_code_t hoxml_run(hoxml_context_t* context) {
+    const char* previous_iterator;
+    size_t previous_stream_length;
+    int previous_line, previous_column;
+
+    /* Remember some context variables in case we hit an unexpected EoF and need to undo an iteration */
+    previous_iterator = context->iterator;
+    previous_stream_length = context->stream_length;
+    previous_line = context->line;
+    previous_column = context->column;
+    while (context->state >= HOXML_STATE_NONE && context->state <= HOXML_STATE_DONE) {
+        size_t bytes_remaining, bytes_to_copy;
+        hoxml_character_t c;
+
+        /* About half of the parsing states assume the stack is non-null. */
+        /* If parsing is currently in one of those states and the stack (head) pointer is null. */
+        if (((context->state >= HOXML_STATE_TAG_BEGIN && context->state <= HOXML_STATE_OPEN_TAG) ||
+                (context->state >= HOXML_STATE_REFERENCE_BEGIN && context->state <= HOXML_STATE_REFERENCE_HEX) ||
+                (context->state >= HOXML_STATE_SKIP_CONTENT && context->state < HOXML_STATE_DONE)) &&
+                context->stack == NULL) {
+            /* Some unforseen bug has led us to a state in which continuing would cause an illegal memory access. */
+            /* Parsing must halt. There is no way to recover. */
+            context->state = HOXML_STATE_ERROR_INTERNAL;
+            return HOXML_ERROR_INTERNAL;
+        }
+
+        /* With hoxml_parse_budget(), stop once the budget is spent. The state is kept so parsing picks up from here. */
+        if (context->budget_end != NULL && context->iterator >= context->budget_end)
+            return HOXML_YIELD;
+
+        /* Long runs of character data are scanned and copied in bulk rather than one character at a time */
+        if (context->stream_length == 0 && (context->state == HOXML_STATE_OPEN_TAG ||
+                context->state == HOXML_STATE_ATTRIBUTE_VALUE || context->state == HOXML_STATE_COMMENT ||
+                context->state == HOXML_STATE_CDATA_CONTENT || context->state == HOXML_STATE_SKIP_CONTENT ||
+                context->state == HOXML_STATE_SKIP_DOUBLE_QUOTE || context->state == HOXML_STATE_SKIP_SINGLE_QUOTE ||
+                context->state == HOXML_STATE_SKIP_COMMENT || context->state == HOXML_STATE_SKIP_CDATA))
+            hoxml_scan_character_data(context);
+
+        /* Calculate the number of bytes remaining in the current XML content string */
+        bytes_remaining = (size_t)(context->xml_length - (context->iterator - context->xml));
+        if (context->stream_length == 0) {
+            /* In the usual case, decode the character straight from the XML content string */
+            bytes_to_copy = 0;
+            if (bytes_remaining == 0) {
+                c.codepoint = 0;
+                c.encoded = 0;
+                c.bytes = 0;
+            } else
+                c = hoxml_decode_character(context->iterator, bytes_remaining, context->encoding);
+        } else {
+            /* A character was split between this and a previous XML content string so its first bytes were stashed */
+            /* in the 'stream' variable. Append the new bytes to the previous one(s), up to four bytes in total. */
+            bytes_to_copy = 4 - context->stream_length;
+            if (bytes_to_copy > bytes_remaining)
+                bytes_to_copy = bytes_remaining;
+            memcpy((char*)&(context->stream) + context->stream_length, context->iterator, bytes_to_copy);
+            c = hoxml_decode_character((const char*)&(context->stream), context->stream_length + bytes_to_copy,
+                context->encoding);
+            /* With lazy positions, a character pieced together like this is counted now and the rest later */
+            if (context->options & HOXML_OPTION_LAZY_POSITION && c.bytes > context->stream_length)
+                context->position = context->iterator + c.bytes - context->stream_length;
+        }
+
+        /* If the character is the equivalent of a null terminator or there was not enough data to decode the value */
+        previous_line = context->line;
+        previous_column = context->column;
+        if (c.codepoint == 0 || c.codepoint == UINT32_MAX) {
+            /* With text codes, text that's a view can be handed out now rather than copied */
+            if (context->options & HOXML_OPTION_TEXT && context->state == HOXML_STATE_OPEN_TAG &&
+                    context->view != NULL && hoxml_end_text(context))
+                return HOXML_TEXT;
+            /* The XML content string is about to be replaced so views into it have to be copied to the stack now */
+            hoxml_copy_views(context);
+            if (context->state == HOXML_STATE_ERROR_INSUFFICIENT_MEMORY) {
+                /* With an allocator, memory is added and the same character found again to copy what's left */
+                if (context->allocator.allocate != NULL && hoxml_grow(context))
+                    return hoxml_run(context);
+                return HOXML_ERROR_INSUFFICIENT_MEMORY;
+            }
+            if (c.codepoint == UINT32_MAX) { /* If the string ended partway through a character */
+                /* Stash the character's first bytes in the 'stream' variable to be pieced together with the rest of */
+                /* it from the next string */
+                if (context->stream_length == 0) {
+                    memcpy(&(context->stream), context->iterator, bytes_remaining);
+                    context->stream_length = bytes_remaining;
+                } else
+                    context->stream_length += bytes_to_copy;
+            }
+            context->error_return_state = context->state;
+            context->state = HOXML_STATE_ERROR_UNEXPECTED_EOF;
+            return HOXML_ERROR_UNEXPECTED_EOF;
+        } else if (!(context->options & HOXML_OPTION_LAZY_POSITION) || context->stream_length != 0) {
+            /* Count the character now unless it will be counted later, in bulk, with the characters around it */
+            if (HOXML_IS_NEW_LINE(c.codepoint)) {
+                if (context->newline_character == 0) /* If this is the first newline */
+                    context->newline_character = c.codepoint; /* Remember this as the character to use for increments */
+                if (c.codepoint == context->newline_character) /* Avoid incrementing twice for \r\n endings */
+                    context->line++;
+                context->column = 0;
+            } else
+                context->column++;
+        }
 
         /* Iterate up to four bytes into the XML content string. The idea is to jump forward by the number of bytes */
         /* that were just decoded as a single character. The number of bytes varies from one to four bytes depending */
@@ -477,6 +1945,7 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
         /* stashed in the context's 'stream' variable where 'stream_length' tells us the number of said bytes. */
         previous_iterator = context->iterator;
         previous_stream_length = context->stream_length;
+        context->character = context->stream_length == 0 ? context->iterator : NULL;
         context->iterator += c.bytes - context->stream_length;
         context->stream_length = 0;
 
@@ -501,6 +1970,16 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             } else if (c.encoded == 0xFF) { /* UTF-16LE BOM is [FF] FE, as hex bytes */
                 context->state = HOXML_STATE_UTF16LE_BOM;
                 context->column--; /* Don't count this as a column */
+            } else if (c.codepoint == 0xFEFF && HOXML_IS_UTF_16(context->encoding)) {
+                /* In a stream, a UTF-16 document's BOM is decoded as one in the previous document's byte order */
+                context->column--; /* Don't count this as a column */
+            } else if (c.codepoint == 0xFFFE && HOXML_IS_UTF_16(context->encoding)) {
+                /* The BOM is in the other byte order so the bytes are swapped from here on */
+                context->column--; /* Don't count this as a column */
+                hoxml_count_position(context); /* Characters found so far are counted as the encoding was */
+                context->encoding = context->encoding == HOXML_ENC_UTF_16_LE ? HOXML_ENC_UTF_16_BE :
+                    HOXML_ENC_UTF_16_LE;
+                context->string_encoding = context->options & HOXML_OPTION_UTF_8 ? HOXML_ENC_UTF_8 : context->encoding;
             } else if (!HOXML_IS_WHITESPACE(c.codepoint))
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
@@ -517,7 +1996,8 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             context->column--; /* Don't count this as a column */
             if (c.encoded == 0xBF) { /* UTF-8 BOM is EF BB [BF], as hex bytes */
                 context->state = HOXML_STATE_NONE;
-                context->encoding = HOXML_ENC_UTF_8;
+                hoxml_count_position(context); /* Characters found so far are counted as the encoding was */
+                context->encoding = context->string_encoding = HOXML_ENC_UTF_8;
             } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
@@ -526,7 +2006,10 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             context->column--; /* Don't count this as a column */
             if (c.encoded == 0xFF) { /* UTF-16BE BOM is FE [FF], as hex bytes */
                 context->state = HOXML_STATE_NONE;
+                hoxml_count_position(context); /* Characters found so far are counted as the encoding was */
                 context->encoding = HOXML_ENC_UTF_16_BE;
+                /* With the UTF-8 option, strings are transcoded as they're appended to the stack */
+                context->string_encoding = context->options & HOXML_OPTION_UTF_8 ? HOXML_ENC_UTF_8 : context->encoding;
             } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
@@ -535,12 +2018,21 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             context->column--; /* Don't count this as a column */
             if (c.encoded == 0xFE) { /* UTF-16LE BOM is FF [FE], as hex bytes */
                 context->state = HOXML_STATE_NONE;
+                hoxml_count_position(context); /* Characters found so far are counted as the encoding was */
                 context->encoding = HOXML_ENC_UTF_16_LE;
+                /* With the UTF-8 option, strings are transcoded as they're appended to the stack */
+                context->string_encoding = context->options & HOXML_OPTION_UTF_8 ? HOXML_ENC_UTF_8 : context->encoding;
             } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_TAG_BEGIN: /* A new tag was started (a '<' was found) and a new node has been pushed */
             HOXML_LOG_STATE("HOXML_STATE_TAG_BEGIN")
+            /* Only a close tag can follow content that's a view */
+            if (c.codepoint != '/' && !(HOXML_STACK->flags & HOXML_FLAG_END_TAG)) {
+                hoxml_copy_views(context);
+                if (context->state < HOXML_STATE_NONE) /* If copying the view was unsuccessful */
+                    break;
+            }
             if (c.codepoint == '?') { /* "<?" begins a processing instruction */
                 context->state = HOXML_STATE_PROCESSING_INSTRUCTION_BEGIN;
                 HOXML_STACK->flags |= HOXML_FLAG_PROCESSING_INSTRUCTION; /* Apply the PI flag to this node */
@@ -553,12 +2045,20 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                 if (context->state >= HOXML_STATE_NONE) { /* If appending the character was successful */
                     context->state = HOXML_STATE_ELEMENT_NAME1;
                     context->tag = &(HOXML_STACK->tag); /* The tag's name string will begin here */
+                    context->name_hash = HOXML_HASH(HOXML_HASH_BASIS, c.codepoint);
                 }
             } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_ELEMENT_NAME1: /* A name start character was found after '<' (e.g. the 't' in "<tag>") */
             HOXML_LOG_STATE("HOXML_STATE_ELEMENT_NAME1")
+            /* With symbols, the name is looked up once it ends. It's the only string in the node so far. The '>' */
+            /* of an empty element (e.g. "<tag/>") is also parsed in this state but its name was looked up already. */
+            if (context->symbols != NULL && !(HOXML_STACK->flags & HOXML_FLAG_TERMINATED) && (c.codepoint == '>' ||
+                    c.codepoint == '/' || HOXML_IS_WHITESPACE(c.codepoint)))
+                HOXML_SET_NODE_ID(HOXML_STACK, hoxml_find_symbol(context->symbols, context->name_hash,
+                    &(HOXML_STACK->tag), (size_t)(HOXML_END(HOXML_STACK) + 1 - &(HOXML_STACK->tag)),
+                    context->string_encoding));
             if (c.codepoint == '>') {
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
@@ -580,9 +2080,10 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                     HOXML_STACK->flags |= HOXML_FLAG_BEGUN; /* Indicate "element begun" has already been returned */
                     return HOXML_ELEMENT_BEGIN;
                 }
-            } else if (HOXML_IS_NAME_CHAR(c.codepoint))
+            } else if (HOXML_IS_NAME_CHAR(c.codepoint)) {
                 hoxml_append_character(context, c);
-            else
+                context->name_hash = HOXML_HASH(context->name_hash, c.codepoint);
+            } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_ELEMENT_NAME2: /* Whitespace was found after a tag name (e.g. "<tag    >") */
@@ -596,6 +2097,8 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                             !(HOXML_STACK->flags & HOXML_FLAG_EMPTY_ELEMENT)) {
                         hoxml_end_tag(context); /* Do not return, "element begun" was returned when the name ended */
                         hoxml_post_state_cleanup(context); /* Because hoxml_parse() won't be called, clean up now */
+                        context->depth += context->depth_change; /* And apply the change in depth now too */
+                        context->depth_change = 0;
                     } else
                         return hoxml_end_tag(context);
                 }
@@ -605,23 +2108,36 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                 else
                     HOXML_STACK->flags |= HOXML_FLAG_EMPTY_ELEMENT; /* Apply the empty element flag to this node */
             } else if (HOXML_IS_NAME_START_CHAR(c.codepoint)) { /* First letter of an attribute name */
+                context->attribute = HOXML_END(HOXML_STACK) + 1; /* The attribute's name string begins here */
+                if (context->options & HOXML_OPTION_VIEWS) {
+                    HOXML_STACK->flags |= HOXML_FLAG_VIEW;
+                    context->view_string = &(context->attribute);
+                }
                 hoxml_append_character(context, c);
                 if (context->state >= HOXML_STATE_NONE) { /* If appending the character was successful */
                     context->state = HOXML_STATE_ATTRIBUTE_NAME1;
-                    context->attribute = HOXML_STACK->end; /* The attribute's name string began here */
+                    context->name_hash = HOXML_HASH(HOXML_HASH_BASIS, c.codepoint);
                 }
             } else if (!HOXML_IS_WHITESPACE(c.codepoint))
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_ATTRIBUTE_NAME1: /* A name start character was found inside a tag after whitespace */
             HOXML_LOG_STATE("HOXML_STATE_ATTRIBUTE_NAME1")
+            /* With symbols, the name is looked up once it ends, whether it's a view or on the stack */
+            if (context->symbols != NULL && (c.codepoint == '=' || HOXML_IS_WHITESPACE(c.codepoint)))
+                context->attribute_id = HOXML_STACK->flags & HOXML_FLAG_VIEW && context->view != NULL ?
+                    hoxml_find_symbol(context->symbols, context->name_hash, context->view, context->view_length,
+                        context->string_encoding) :
+                    hoxml_find_symbol(context->symbols, context->name_hash, context->attribute,
+                        (size_t)(HOXML_END(HOXML_STACK) + 1 - context->attribute), context->string_encoding);
             if (c.codepoint == '=') { /* The name was immediately followed by '=' */
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
                     context->state = HOXML_STATE_ATTRIBUTE_ASSIGNMENT;
-            } else if (HOXML_IS_NAME_CHAR(c.codepoint))
+            } else if (HOXML_IS_NAME_CHAR(c.codepoint)) {
                 hoxml_append_character(context, c);
-            else if (HOXML_IS_WHITESPACE(c.codepoint)) { /* Whitespace after the name, only '=' is allowed next */
+                context->name_hash = HOXML_HASH(context->name_hash, c.codepoint);
+            } else if (HOXML_IS_WHITESPACE(c.codepoint)) { /* Whitespace after the name, only '=' is allowed next */
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
                     context->state = HOXML_STATE_ATTRIBUTE_NAME2;
@@ -643,7 +2159,11 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                     HOXML_STACK->flags |= HOXML_FLAG_DOUBLE_QUOTE; /* Apply the double quote flag to this node */
                 else
                     HOXML_STACK->flags &= ~HOXML_FLAG_DOUBLE_QUOTE; /* Remove the double quote flag from this node */
-                context->value = HOXML_STACK->end + 1; /* The attribute's value string will begin here */
+                context->value = HOXML_END(HOXML_STACK) + 1; /* The attribute's value string will begin here */
+                if (context->options & HOXML_OPTION_VIEWS) {
+                    HOXML_STACK->flags |= HOXML_FLAG_VIEW;
+                    context->view_string = &(context->value);
+                }
             }
             else if (!HOXML_IS_WHITESPACE(c.codepoint))
                 context->state = HOXML_STATE_ERROR_SYNTAX;
@@ -652,6 +2172,14 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             HOXML_LOG_STATE("HOXML_STATE_ATTRIBUTE_VALUE")
             if ((HOXML_STACK->flags & HOXML_FLAG_DOUBLE_QUOTE && c.codepoint == '"') || (!(HOXML_STACK->flags &
                     HOXML_FLAG_DOUBLE_QUOTE) && c.codepoint == '\'')) { /* The quotation marks match, value is done */
+                if (context->view == NULL && context->value == HOXML_END(HOXML_STACK) + 1) { /* If it's empty */
+                    /* The value has no characters of its own so the stack still ends with the name's terminator, */
+                    /* or the tag's, and the value needs its own. Copy a name that's a view first so it follows. */
+                    hoxml_copy_views(context);
+                    if (context->state < HOXML_STATE_NONE) /* If copying the name was unsuccessful */
+                        break;
+                    HOXML_STACK->flags &= ~HOXML_FLAG_TERMINATED;
+                }
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) { /* If appending the terminator was successful */
                     context->state = HOXML_STATE_ELEMENT_NAME2;
@@ -659,8 +2187,11 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                     return HOXML_ATTRIBUTE;
                 }
             } else if (c.codepoint == '&') {
-                context->state = HOXML_STATE_REFERENCE_BEGIN;
-                context->return_state = HOXML_STATE_ATTRIBUTE_VALUE; /* Return to this attribute value state later */
+                hoxml_copy_views(context); /* The referenced character will be appended to the stack */
+                if (context->state >= HOXML_STATE_NONE) { /* If copying any views was successful */
+                    context->state = HOXML_STATE_REFERENCE_BEGIN;
+                    context->return_state = HOXML_STATE_ATTRIBUTE_VALUE; /* Return to this value state later */
+                }
             } else if (HOXML_IS_VALUE_CHAR_DATA(HOXML_STACK->flags, c.codepoint))
                 hoxml_append_character(context, c);
             else
@@ -668,11 +2199,22 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             break;
         case HOXML_STATE_OPEN_TAG: /* Found a '>' and now inside an open tag, looking for multiple things */
             HOXML_LOG_STATE("HOXML_STATE_OPEN_TAG")
-            if (c.codepoint == '<')
+            if (c.codepoint == '<') {
+                /* With text codes, the text so far ends here. Return it and parse the '<' again next call. */
+                if (context->options & HOXML_OPTION_TEXT && hoxml_end_text(context)) {
+                    context->iterator = previous_iterator;
+                    context->stream_length = previous_stream_length;
+                    context->line = previous_line;
+                    context->column = previous_column;
+                    return HOXML_TEXT;
+                }
                 hoxml_begin_tag(context);
-            else if (c.codepoint == '&') {
-                context->state = HOXML_STATE_REFERENCE_BEGIN;
-                context->return_state = HOXML_STATE_OPEN_TAG; /* Return to this open tag state later */
+            } else if (c.codepoint == '&') {
+                hoxml_copy_views(context); /* The referenced character will be appended to the stack */
+                if (context->state >= HOXML_STATE_NONE) { /* If copying any views was successful */
+                    context->state = HOXML_STATE_REFERENCE_BEGIN;
+                    context->return_state = HOXML_STATE_OPEN_TAG; /* Return to this open tag state later */
+                }
             } else if (HOXML_IS_CHAR_DATA(c.codepoint))
                 hoxml_append_character(context, c);
             else
@@ -789,10 +2331,9 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
                 context->state = HOXML_STATE_OPEN_TAG;
                 /* We couldn't be sure the CDATA section had ended until now so two ']' characters were appended. */
                 /* If the document is encoded with UTF-16, four bytes need to be removed. Two bytes otherwise. */
-                bytes = context->encoding == HOXML_ENC_UTF_16_LE || context->encoding == HOXML_ENC_UTF_16_BE ? 4 : 2;
+                bytes = HOXML_IS_UTF_16(context->string_encoding) ? 4 : 2;
                 /* The 'end' pointer is currently pointing at the last byte, the second ']' or its latter half if */
-                /* using UTF-16. To remove the "]]" we replace them with zeroes. */
-                memset(HOXML_STACK->end - bytes + 1, 0, bytes);
+                /* using UTF-16. To remove the "]]" we move it back before them. */
                 HOXML_STACK->end -= bytes;
             } else {
                 hoxml_append_character(context, c);
@@ -801,45 +2342,43 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             } break;
         case HOXML_STATE_REFERENCE_BEGIN: /* Found an '&' in content or a value, looking for '#', ';', or characters */
             HOXML_LOG_STATE("HOXML_STATE_REFERENCE_BEGIN")
-            context->reference_start = HOXML_STACK->end + 1; /* Point to the first byte for comparisons later */
-            if (c.codepoint == '#')
+            if (c.codepoint == '#') {
+                context->reference_value = 0;
                 context->state = HOXML_STATE_REFERENCE_NUMERIC;
-            /* The predefined entities are "amp", "lt", "gt", "quot", and "apos". Check for just their first letters. */
-            else if (c.codepoint == 'a' || c.codepoint == 'g' || c.codepoint == 'l' || c.codepoint == 'q') {
-                hoxml_append_character(context, c);
-                if (context->state >= HOXML_STATE_NONE) /* If appending the character was successful */
-                    context->state = HOXML_STATE_REFERENCE_ENTITY;
-            } else
+            } else if (hoxml_match_entity(context, c.codepoint, 1)) /* If it may begin one of the predefined entities */
+                context->state = HOXML_STATE_REFERENCE_ENTITY;
+            else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_REFERENCE_ENTITY: /* Looking for "[a]mp", "[l]t", "[g]t", "[q]uot", or "apos" */
             HOXML_LOG_STATE("HOXML_STATE_REFERENCE_ENTITY")
             if (c.codepoint == ';')
                 hoxml_end_reference(context, HOXML_REF_TYPE_ENTITY);
-            /* Predefined escapes only use a subset of lower case English characters. For now, we'll check for ASCII. */
-            else if (HOXML_IS_ASCII_CHAR(c.codepoint))
-                hoxml_append_character(context, c);
-            else
+            else if (!hoxml_match_entity(context, c.codepoint, 0)) /* If it isn't the name of a predefined entity */
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_REFERENCE_NUMERIC: /* Found a '#' in a reference, looking for 'x', ';', or chars */
             HOXML_LOG_STATE("HOXML_STATE_REFERENCE_NUMERIC")
-            if (c.codepoint == 'x')
+            if (c.codepoint == 'x' && context->reference_value == 0)
                 context->state = HOXML_STATE_REFERENCE_HEX;
             else if (c.codepoint == ';')
                 hoxml_end_reference(context, HOXML_REF_TYPE_NUMERIC);
-            else if (HOXML_IS_NUMERIC(c.codepoint))
-                hoxml_append_character(context, c);
-            else
+            else if (HOXML_IS_NUMERIC(c.codepoint)) {
+                /* The digits aren't kept, only the value they add up to. Past Unicode's range, it stops growing. */
+                if (context->reference_value <= 0x10FFFF)
+                    context->reference_value = context->reference_value * 10 + (c.codepoint - '0');
+            } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_REFERENCE_HEX: /* Found an 'x' in a reference after '#', looking for chars or ';' */
             HOXML_LOG_STATE("HOXML_STATE_REFERENCE_HEX")
             if (c.codepoint == ';')
                 hoxml_end_reference(context, HOXML_REF_TYPE_HEX);
-            else if (HOXML_IS_HEX_CHAR(c.codepoint))
-                hoxml_append_character(context, c);
-            else
+            else if (HOXML_IS_HEX_CHAR(c.codepoint)) {
+                if (context->reference_value <= 0x10FFFF) /* As above, past Unicode's range, it stops growing */
+                    context->reference_value = context->reference_value * 16 +
+                        (c.codepoint <= '9' ? c.codepoint - '0' : (c.codepoint | 0x20) - 'a' + 10);
+            } else
                 context->state = HOXML_STATE_ERROR_SYNTAX;
             break;
         case HOXML_STATE_PROCESSING_INSTRUCTION_BEGIN: /* Found a '?' after a '<' and now in a processing instruction */
@@ -856,17 +2395,28 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
         case HOXML_STATE_PROCESSING_INSTRUCTION_TARGET1: /* Found a name char after "<?", looking for more name chars */
             HOXML_LOG_STATE("HOXML_STATE_PROCESSING_INSTRUCTION_TARGET1")
             if (HOXML_IS_WHITESPACE(c.codepoint)) { /* A whitespace marks an end of a target and beginning of content */
-                if (hoxml_strcmp(&(HOXML_STACK->tag), context->encoding, "xml", HOXML_ENC_UNKNOWN,
-                        HOXML_CASE_INSENSITIVE) && HOXML_STACK->parent != NULL) {
+                int is_declaration;
+
+                hoxml_append_terminator(context);
+                if (context->state < HOXML_STATE_NONE) /* If appending the terminator was unsuccessful */
+                    break;
+                /* The target is the document declaration's if it's exactly "xml", in any case, not only begins so */
+                is_declaration = hoxml_strcmp(&(HOXML_STACK->tag), context->string_encoding, "xml", HOXML_ENC_UNKNOWN,
+                    HOXML_CASE_INSENSITIVE) && hoxml_strcmp("xml", HOXML_ENC_UNKNOWN, &(HOXML_STACK->tag),
+                    context->string_encoding, HOXML_CASE_INSENSITIVE);
+                if (is_declaration && HOXML_STACK->parent != HOXML_NO_PARENT) {
                     /* The document declaration (e.g. <?xml encoding="UTF-8"?>) must come before the first element */
                     context->state = HOXML_STATE_ERROR_INVALID_DOCUMENT_DECLARATION;
                     return HOXML_ERROR_INVALID_DOCUMENT_DECLARATION;
                 }
-                hoxml_append_terminator(context);
-                if (context->state >= HOXML_STATE_NONE) { /* If appending the terminator was successful */
-                    context->state = HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT;
-                    return HOXML_PROCESSING_INSTRUCTION_BEGIN;
+                context->state = HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT;
+                if (is_declaration) { /* Only the document declaration's content is parsed any further */
+                    context->declaration = HOXML_DECLARATION_NAME_BEGIN;
+                    context->declaration_name = -1;
+                    context->version[0] = context->declared_encoding[0] = '\0';
+                    context->standalone = -1;
                 }
+                return HOXML_PROCESSING_INSTRUCTION_BEGIN;
             } else if (c.codepoint == '?') { /* A '?' (or "?>") marks the end of the target and PI */
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
@@ -878,59 +2428,42 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             break;
         case HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT: /* Found space after a PI name, looking for '?' or chars */
             HOXML_LOG_STATE("HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT")
-            if (c.codepoint == '?') { /* "?>" marks the end of a processing instruction */
-                const char* declaration;
-
-                if ((declaration = hoxml_strstr(context->content, context->encoding, "encoding=", HOXML_ENC_UNKNOWN,
-                        HOXML_CASE_SENSITIVE)) != NULL) {
-                    const char* encoding;
-
-                    if ((encoding = hoxml_strstr(declaration, context->encoding, "\"", HOXML_ENC_UNKNOWN,
-                            HOXML_CASE_SENSITIVE)) != NULL || (encoding = hoxml_strstr(declaration, context->encoding,
-                            "'", HOXML_ENC_UNKNOWN, HOXML_CASE_SENSITIVE)) != NULL) {
-                        switch (context->encoding) {
-                        case HOXML_ENC_UNKNOWN: /* The document did not begin with a byte order marker (BOM) */
-                            if (hoxml_strcmp(encoding, context->encoding, "\"UTF-8\"", HOXML_ENC_UNKNOWN,
-                                    HOXML_CASE_INSENSITIVE) != 0 || hoxml_strcmp(encoding, context->encoding,
-                                    "'UTF-8'", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE) != 0) {
-                                context->encoding = HOXML_ENC_UTF_8;
-                            } else if (hoxml_strcmp(encoding, context->encoding, "\"UTF-16\"", HOXML_ENC_UNKNOWN,
-                                    HOXML_CASE_INSENSITIVE) != 0 || hoxml_strcmp(encoding, context->encoding,
-                                    "'UTF-16'", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE) != 0) {
-                                /* UTF-16 encoded documents require one of the UTF-16 BOMs so this is an error */
-                                context->state = HOXML_STATE_ERROR_ENCODING;
-                                return HOXML_ERROR_ENCODING;
-                            } break;
-                        case HOXML_ENC_UTF_8: /* The UTF-8 BOM was found at the beginning of the document */
-                            if (hoxml_strcmp(encoding, context->encoding, "\"UTF-8\"", HOXML_ENC_UNKNOWN,
-                                    HOXML_CASE_INSENSITIVE) == 0 && hoxml_strcmp(encoding, context->encoding,
-                                    "'UTF-8'", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE) == 0) {
-                                /* If the UTF-8 BOM was found but the encoding declaration was not "UTF-8" then we */
-                                /* have a contradiction and, therefore, an error */
-                                context->state = HOXML_STATE_ERROR_ENCODING;
-                                return HOXML_ERROR_ENCODING;
-                            } break;
-                        case HOXML_ENC_UTF_16_LE: /* The UTF-16LE BOM was found at the beginning of the document */
-                        case HOXML_ENC_UTF_16_BE: /* The UTF-16BE BOM was found at the beginning of the document */
-                            if (hoxml_strcmp(encoding, context->encoding, "\"UTF-16\"", HOXML_ENC_UNKNOWN,
-                                    HOXML_CASE_INSENSITIVE) == 0 && hoxml_strcmp(encoding, context->encoding,
-                                    "'UTF-16'", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE) == 0)
-                                return HOXML_ERROR_ENCODING;
-                            break;
-                        }
-                    }
-                }
+            if (c.codepoint == '?' && context->declaration == HOXML_DECLARATION_NONE) /* Maybe the end, "?>" */
+                context->state = HOXML_STATE_PROCESSING_INSTRUCTION_QUESTION;
+            else if (c.codepoint == '?') { /* The first '?' outside of a value ends the document declaration */
+                if (!hoxml_parse_declaration(context, c.codepoint))
+                    return context->state == HOXML_STATE_ERROR_ENCODING ? HOXML_ERROR_ENCODING :
+                        HOXML_ERROR_INVALID_DOCUMENT_DECLARATION;
                 hoxml_append_terminator(context);
                 if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
                     context->state = HOXML_STATE_PROCESSING_INSTRUCTION_END;
             } else {
                 if (context->content == NULL) /* If this is the first character of the PI's content */
-                    context->content = HOXML_STACK->end + 1; /* The PI's content string will begin here */
+                    context->content = HOXML_END(HOXML_STACK) + 1; /* The PI's content string will begin here */
                 hoxml_append_character(context, c);
+                /* The document declaration is parsed as it's found, once each character was successfully appended */
+                if (context->state >= HOXML_STATE_NONE && context->declaration != HOXML_DECLARATION_NONE &&
+                        !hoxml_parse_declaration(context, c.codepoint))
+                    return HOXML_ERROR_INVALID_DOCUMENT_DECLARATION;
             } break;
-        case HOXML_STATE_DTD_BEGIN1: /* Found a 'D' after "<!", looking for 'O' */
-            HOXML_LOG_STATE("HOXML_STATE_DTD_BEGIN1")
-            hoxml_pop_stack(context); /* The preceeding '<' triggered a new node. Undo it. */
+        case HOXML_STATE_PROCESSING_INSTRUCTION_QUESTION: /* Found a '?' in PI content, looking for '>' or chars */
+            HOXML_LOG_STATE("HOXML_STATE_PROCESSING_INSTRUCTION_QUESTION")
+            if (c.codepoint == '>') { /* "?>" marks the end of a processing instruction */
+                hoxml_append_terminator(context);
+                if (context->state >= HOXML_STATE_NONE) /* If appending the terminator was successful */
+                    return hoxml_end_tag(context);
+            } else { /* The '?' was part of the content and so is this character, unless it's another '?' */
+                if (context->content == NULL) /* If the '?' was the first character of the PI's content */
+                    context->content = HOXML_END(HOXML_STACK) + 1;
+                hoxml_append_character(context, hoxml_encode_character('?', context->encoding));
+                if (context->state >= HOXML_STATE_NONE && c.codepoint != '?') {
+                    context->state = HOXML_STATE_PROCESSING_INSTRUCTION_CONTENT;
+                    hoxml_append_character(context, c);
+                }
+            } break;
+        case HOXML_STATE_DTD_BEGIN1: /* Found a 'D' after "<!", looking for 'O' */
+            HOXML_LOG_STATE("HOXML_STATE_DTD_BEGIN1")
+            hoxml_pop_stack(context); /* The preceeding '<' triggered a new node. Undo it. */
             if (c.codepoint == 'O')
                 context->state = HOXML_STATE_DTD_BEGIN2;
             else
@@ -1011,6 +2544,130 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
             if (c.codepoint == ']')
                 context->state = HOXML_STATE_DTD_CONTENT;
             break;
+        case HOXML_STATE_SKIP_CONTENT: /* Skipping an element's content, looking for '<' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_CONTENT")
+            if (c.codepoint == '<')
+                context->state = HOXML_STATE_SKIP_MARKUP;
+            break;
+        case HOXML_STATE_SKIP_MARKUP: /* Found a '<' while skipping, the following character says what it begins */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_MARKUP")
+            if (c.codepoint == '/')
+                context->state = HOXML_STATE_SKIP_END_TAG;
+            else if (c.codepoint == '!')
+                context->state = HOXML_STATE_SKIP_DECLARATION;
+            else if (c.codepoint == '?')
+                context->state = HOXML_STATE_SKIP_PROCESSING_INSTRUCTION;
+            else
+                context->state = HOXML_STATE_SKIP_TAG;
+            break;
+        case HOXML_STATE_SKIP_TAG: /* Skipping an open tag or empty element, looking for '>' outside of quotes */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_TAG")
+            if (c.codepoint == '>') {
+                if (context->skip_depth < 0) /* If this ended the skipped element's own open tag */
+                    context->depth++; /* As with an open tag that returned "element begun" before ending */
+                context->skip_depth++;
+                context->state = HOXML_STATE_SKIP_CONTENT;
+            } else if (c.codepoint == '/')
+                context->state = HOXML_STATE_SKIP_TAG_SLASH;
+            else if (c.codepoint == '"')
+                context->state = HOXML_STATE_SKIP_DOUBLE_QUOTE;
+            else if (c.codepoint == '\'')
+                context->state = HOXML_STATE_SKIP_SINGLE_QUOTE;
+            break;
+        case HOXML_STATE_SKIP_TAG_SLASH: /* Found a '/' while skipping a tag, it's an empty element if '>' is next */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_TAG_SLASH")
+            if (c.codepoint == '>') {
+                if (context->skip_depth < 0) { /* If the skipped element itself is empty (e.g. "<tag a='b'/>") */
+                    HOXML_STACK->flags |= HOXML_FLAG_EMPTY_ELEMENT;
+                    return hoxml_end_skip(context);
+                }
+                context->state = HOXML_STATE_SKIP_CONTENT; /* An empty element doesn't change the nesting */
+            } else if (c.codepoint == '"')
+                context->state = HOXML_STATE_SKIP_DOUBLE_QUOTE;
+            else if (c.codepoint == '\'')
+                context->state = HOXML_STATE_SKIP_SINGLE_QUOTE;
+            else if (c.codepoint != '/')
+                context->state = HOXML_STATE_SKIP_TAG;
+            break;
+        case HOXML_STATE_SKIP_DOUBLE_QUOTE: /* Skipping a double-quoted attribute value, looking for '"' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_DOUBLE_QUOTE")
+            if (c.codepoint == '"')
+                context->state = HOXML_STATE_SKIP_TAG;
+            break;
+        case HOXML_STATE_SKIP_SINGLE_QUOTE: /* Skipping a single-quoted attribute value, looking for ''' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_SINGLE_QUOTE")
+            if (c.codepoint == '\'')
+                context->state = HOXML_STATE_SKIP_TAG;
+            break;
+        case HOXML_STATE_SKIP_END_TAG: /* Skipping a close tag, looking for '>' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_END_TAG")
+            if (c.codepoint == '>') {
+                if (context->skip_depth == 0) /* If this closed the skipped element */
+                    return hoxml_end_skip(context);
+                context->skip_depth--;
+                context->state = HOXML_STATE_SKIP_CONTENT;
+            }
+            break;
+        case HOXML_STATE_SKIP_DECLARATION: /* Found "<!" while skipping, only a comment or CDATA may follow */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_DECLARATION")
+            if (c.codepoint == '-')
+                context->state = HOXML_STATE_SKIP_COMMENT_BEGIN;
+            else if (c.codepoint == '[') /* The rest of "<![CDATA[" can't contain ']' so it's skipped as content */
+                context->state = HOXML_STATE_SKIP_CDATA;
+            else
+                context->state = HOXML_STATE_ERROR_SYNTAX;
+            break;
+        case HOXML_STATE_SKIP_COMMENT_BEGIN: /* Found "<!-" while skipping, looking for the second '-' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_COMMENT_BEGIN")
+            if (c.codepoint == '-')
+                context->state = HOXML_STATE_SKIP_COMMENT;
+            else
+                context->state = HOXML_STATE_ERROR_SYNTAX;
+            break;
+        case HOXML_STATE_SKIP_COMMENT: /* Skipping a comment, looking for '-' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_COMMENT")
+            if (c.codepoint == '-')
+                context->state = HOXML_STATE_SKIP_COMMENT_END1;
+            break;
+        case HOXML_STATE_SKIP_COMMENT_END1: /* Found a '-' while skipping a comment, looking for another */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_COMMENT_END1")
+            context->state = c.codepoint == '-' ? HOXML_STATE_SKIP_COMMENT_END2 : HOXML_STATE_SKIP_COMMENT;
+            break;
+        case HOXML_STATE_SKIP_COMMENT_END2: /* Found "--" while skipping a comment, looking for '>' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_COMMENT_END2")
+            if (c.codepoint == '>')
+                context->state = HOXML_STATE_SKIP_CONTENT;
+            else if (c.codepoint != '-')
+                context->state = HOXML_STATE_SKIP_COMMENT;
+            break;
+        case HOXML_STATE_SKIP_CDATA: /* Skipping a CDATA section, looking for ']' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_CDATA")
+            if (c.codepoint == ']')
+                context->state = HOXML_STATE_SKIP_CDATA_END1;
+            break;
+        case HOXML_STATE_SKIP_CDATA_END1: /* Found a ']' while skipping a CDATA section, looking for another */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_CDATA_END1")
+            context->state = c.codepoint == ']' ? HOXML_STATE_SKIP_CDATA_END2 : HOXML_STATE_SKIP_CDATA;
+            break;
+        case HOXML_STATE_SKIP_CDATA_END2: /* Found "]]" while skipping a CDATA section, looking for '>' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_CDATA_END2")
+            if (c.codepoint == '>')
+                context->state = HOXML_STATE_SKIP_CONTENT;
+            else if (c.codepoint != ']')
+                context->state = HOXML_STATE_SKIP_CDATA;
+            break;
+        case HOXML_STATE_SKIP_PROCESSING_INSTRUCTION: /* Skipping a processing instruction, looking for '?' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_PROCESSING_INSTRUCTION")
+            if (c.codepoint == '?')
+                context->state = HOXML_STATE_SKIP_PROCESSING_INSTRUCTION_END;
+            break;
+        case HOXML_STATE_SKIP_PROCESSING_INSTRUCTION_END: /* Found a '?' while skipping a PI, looking for '>' */
+            HOXML_LOG_STATE("HOXML_STATE_SKIP_PROCESSING_INSTRUCTION_END")
+            if (c.codepoint == '>')
+                context->state = HOXML_STATE_SKIP_CONTENT;
+            else if (c.codepoint != '?')
+                context->state = HOXML_STATE_SKIP_PROCESSING_INSTRUCTION;
+            break;
         case HOXML_STATE_PROCESSING_INSTRUCTION_END: /* Found a '?' after PI content, looking for '>' */
             HOXML_LOG_STATE("HOXML_STATE_PROCESSING_INSTRUCTION_END")
             if (c.codepoint == '>')
@@ -1030,7 +2687,19 @@ HOXML_DECL hoxml_code_t hoxml_parse(hoxml_context_t* context, const char* xml, c
         /* and parsing can continue on the next call to hoxml_parse() */
         context->iterator = previous_iterator;
         context->stream_length = previous_stream_length;
-        context->column--; /* If recovered, parsing will continue with the same character so don't count this one */
+        /* If recovered, parsing will continue with the same character so don't count this one */
+        context->line = previous_line;
+        context->column = previous_column;
+        /* With text codes, the text so far can be returned and then removed to make room instead */
+        if (context->options & HOXML_OPTION_TEXT && (context->error_return_state == HOXML_STATE_OPEN_TAG ||
+                context->error_return_state == HOXML_STATE_CDATA_CONTENT) && hoxml_end_text(context)) {
+            context->state = context->error_return_state;
+            context->error_return_state = HOXML_STATE_NONE;
+            return HOXML_TEXT;
+        }
+        /* With an allocator, memory is added and parsing carries on with the same character */
+        if (context->allocator.allocate != NULL && hoxml_grow(context))
+            return hoxml_run(context);
         return HOXML_ERROR_INSUFFICIENT_MEMORY;
     }
 
@@ -1044,7 +2713,7 @@ void hoxml_push_stack(hoxml_context_t* context) {
 
     /* If "allocating" a new node would overflow the buffer */
     if ((context->stack == NULL && sizeof(hoxml_node_t) >= context->buffer_length) || (context->stack != NULL &&
-            HOXML_STACK->end + 1 + sizeof(hoxml_node_t) >= context->buffer + context->buffer_length)) {
+            HOXML_END(HOXML_STACK) + 1 + sizeof(hoxml_node_t) >= context->buffer + context->buffer_length)) {
         context->error_return_state = context->state;
         context->state = HOXML_STATE_ERROR_INSUFFICIENT_MEMORY;
         return;
@@ -1053,11 +2722,13 @@ void hoxml_push_stack(hoxml_context_t* context) {
     if (context->stack == NULL)/* If pushing the root node */
         node = (hoxml_node_t*)context->buffer; /* Place the new node at the beginning of the buffer */
     else
-        node = (hoxml_node_t*)(HOXML_STACK->end + 1);
+        node = (hoxml_node_t*)(HOXML_END(HOXML_STACK) + 1);
     if (node != NULL) {
         /* Assign initial values to the node */
-        node->parent = HOXML_STACK; /* This new node's parent is the previous stack node */
-        node->end = &(node->tag) - 1; /* Point to the last byte of the node, -1 because no tag has been copied yet */
+        /* This new node's parent is the previous stack node */
+        node->parent = context->stack == NULL ? HOXML_NO_PARENT : (unsigned)(context->stack - context->buffer);
+        node->end = offsetof(hoxml_node_t, tag) - 1; /* The last byte of the node, -1 because no tag has been copied */
+        node->flags = 0; /* No flags and an ID of HOXML_SYMBOL_NONE */
     }
     context->stack = (char*)node;
 }
@@ -1065,30 +2736,171 @@ void hoxml_push_stack(hoxml_context_t* context) {
 /* Pop the head node from the stack */
 void hoxml_pop_stack(hoxml_context_t* context) {
     hoxml_node_t* popped_node;
+    unsigned parent;
 
     if (context->stack == NULL)
         return;
 
     /* Reassign the stack (head) pointer so that it now points to the parent of the node about to be popped */
     popped_node = HOXML_STACK;
-    context->stack = (char*)popped_node->parent;
+    parent = popped_node->parent;
+    if (popped_node->flags & HOXML_FLAG_VIEW) { /* If the node's string was a view, it's no longer needed */
+        context->view = NULL;
+        context->view_length = 0;
+    }
+    if (parent == HOXML_NO_PARENT)
+        context->stack = NULL;
+    else {
+        /* With an allocator, a node at the beginning of a block was moved there and its parent is in the previous */
+        /* block. The popped node's block is kept as the spare so its memory is left as it is, like any other. */
+        if (context->allocator.allocate != NULL && context->stack == context->buffer)
+            hoxml_release_block(context);
+        context->stack = context->buffer + parent;
+    }
 
-    /* Overwrite the memory used by this node with zeroes */
+    /* The memory used by this node is left as it is, it will be overwritten as needed */
     context->tag = context->attribute = context->value = context->content = NULL; /* TODO: move somewhere else */
-    memset(popped_node, 0, popped_node->end - (char*)popped_node + 1);
+    context->tag_view.data = context->attribute_view.data = context->value_view.data = NULL;
+    context->content_view.data = NULL;
+    context->tag_view.length = context->attribute_view.length = context->value_view.length = 0;
+    context->content_view.length = 0;
+}
+
+/* Find the parent of the head node, or of its parent, or NULL if it's the root. With an allocator, the parent of the */
+/* node at the beginning of a block is in the previous block. */
+hoxml_node_t* hoxml_parent(hoxml_context_t* context, hoxml_node_t* node) {
+    char* base;
+
+    if (node->parent == HOXML_NO_PARENT)
+        return NULL;
+    base = context->buffer;
+    if (context->allocator.allocate != NULL && (char*)node == context->buffer)
+        base = ((hoxml_block_t*)(context->buffer - sizeof(hoxml_block_t)))->previous + sizeof(hoxml_block_t);
+    return (hoxml_node_t*)(base + node->parent);
+}
+
+/* With an allocator, move the head node to a new block with room for it to grow, and for more nodes, leaving the */
+/* rest of the stack where it is. Returns 1 if parsing can continue or 0 if a block couldn't be allocated. */
+int hoxml_grow(hoxml_context_t* context) {
+    char *block, *previous, *first, *data;
+    size_t length, block_length;
+
+    /* The head node, its strings, and the terminator that may follow them are moved. Element content that's still */
+    /* a view belongs to the head's parent and will be copied after the parent's strings so the parent moves too. */
+    first = context->stack;
+    length = 0;
+    if (first != NULL) {
+        if (context->view != NULL && !(HOXML_STACK->flags & HOXML_FLAG_VIEW) && HOXML_STACK->parent != HOXML_NO_PARENT)
+            first = (char*)hoxml_parent(context, HOXML_STACK);
+        length = (size_t)(HOXML_END(HOXML_STACK) + 1 - first) + 2;
+        if (first + length > context->buffer + context->buffer_length)
+            length = (size_t)(context->buffer + context->buffer_length - first);
+    }
+    /* Blocks are at least twice as long as what's moved so that its strings can keep growing without it being */
+    /* moved again and again */
+    if (length > UINT32_MAX / 2) /* No block could hold it with room to grow in the 4 GB of it that can be used */
+        return 0;
+    block_length = context->block_length;
+    while (block_length < sizeof(hoxml_block_t) + 2 * length + sizeof(hoxml_node_t))
+        block_length *= 2;
+    if (context->spare_block != NULL && ((hoxml_block_t*)context->spare_block)->length >= block_length) {
+        block = context->spare_block;
+        block_length = ((hoxml_block_t*)block)->length;
+        context->spare_block = NULL;
+    } else if ((block = (char*)context->allocator.allocate(block_length, context->allocator.user)) == NULL)
+        return 0;
+    /* If nothing stays behind in the block in use, the new block replaces it */
+    previous = context->buffer - sizeof(hoxml_block_t);
+    if (first == NULL || first == context->buffer)
+        previous = ((hoxml_block_t*)previous)->previous;
+    ((hoxml_block_t*)block)->previous = previous;
+    ((hoxml_block_t*)block)->length = block_length;
+    data = block + sizeof(hoxml_block_t);
+
+    if (first != NULL) {
+        /* Only pointers into what's moved need to be reassigned. Nodes below it, and strings in them, stay in */
+        /* place. Nodes hold offsets from themselves to their ends so only the head's parent may change. */
+        memcpy(data, first, length);
+        #define HOXML_MOVE(p) if (p != NULL && p >= first && p <= first + length) p = data + (p - first);
+        HOXML_MOVE(context->tag)
+        HOXML_MOVE(context->attribute)
+        HOXML_MOVE(context->value)
+        HOXML_MOVE(context->content)
+        HOXML_MOVE(context->tag_view.data)
+        HOXML_MOVE(context->attribute_view.data)
+        HOXML_MOVE(context->value_view.data)
+        HOXML_MOVE(context->content_view.data)
+        #undef HOXML_MOVE
+        if (context->stack != first)
+            ((hoxml_node_t*)(data + (context->stack - first)))->parent = 0;
+        context->stack = data + (context->stack - first);
+    }
+    if (previous != context->buffer - sizeof(hoxml_block_t))
+        hoxml_spare_block(context, context->buffer - sizeof(hoxml_block_t));
+    context->buffer = data;
+    context->buffer_length = block_length - sizeof(hoxml_block_t);
+    if (context->buffer_length > UINT32_MAX)
+        context->buffer_length = UINT32_MAX;
+
+    context->state = context->error_return_state;
+    context->error_return_state = HOXML_STATE_NONE;
+    return 1;
+}
+
+/* With an allocator, stop using the block in use and return to the previous one */
+void hoxml_release_block(hoxml_context_t* context) {
+    char* block;
+
+    block = context->buffer - sizeof(hoxml_block_t);
+    context->buffer = ((hoxml_block_t*)block)->previous + sizeof(hoxml_block_t);
+    context->buffer_length = ((hoxml_block_t*)(context->buffer - sizeof(hoxml_block_t)))->length -
+        sizeof(hoxml_block_t);
+    if (context->buffer_length > UINT32_MAX)
+        context->buffer_length = UINT32_MAX;
+    hoxml_spare_block(context, block);
+}
+
+/* With an allocator, keep a block no longer in use, in place of any other, for when memory is needed again */
+void hoxml_spare_block(hoxml_context_t* context, char* block) {
+    if (context->spare_block != NULL)
+        context->allocator.release(context->spare_block, context->allocator.user);
+    context->spare_block = block;
 }
 
 /* Attempt to add the given character to the end of the stack's current head node */
 void hoxml_append_character(hoxml_context_t* context, hoxml_character_t c) {
+    size_t bytes;
+
+    /* If the strings are transcoded, the character is re-encoded and it can't be part of a view */
+    if (context->string_encoding != context->encoding)
+        c = hoxml_encode_character(c.codepoint, context->string_encoding);
+    /* If the node's string can still be a view and this character was read straight from the XML content */
+    else if (HOXML_STACK->flags & HOXML_FLAG_VIEW && context->character != NULL) {
+        if (context->view == NULL) { /* If this is the first character of the string */
+            context->view = context->character;
+            context->view_length = c.bytes;
+            return;
+        } else if (context->view + context->view_length == context->character) { /* If it continues the view */
+            context->view_length += c.bytes;
+            return;
+        }
+    }
+    if (HOXML_STACK->flags & (HOXML_FLAG_VIEW | HOXML_FLAG_ATTRIBUTE_VIEW)) {
+        hoxml_copy_views(context); /* The character must follow whatever the views hold */
+        if (context->state < HOXML_STATE_NONE) /* If copying the views was unsuccessful */
+            return;
+    }
     HOXML_STACK->flags &= ~HOXML_FLAG_TERMINATED;
 
-    if (HOXML_STACK->end + c.bytes >= context->buffer + context->buffer_length) {
+    /* The string will need a terminator, one or two bytes depending on encoding, so leave room for it too */
+    bytes = c.bytes + (HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1);
+    if (HOXML_END(HOXML_STACK) + bytes >= context->buffer + context->buffer_length) {
         context->error_return_state = context->state;
         context->state = HOXML_STATE_ERROR_INSUFFICIENT_MEMORY;
         return;
     }
 
-    memcpy(HOXML_STACK->end + 1, &(c.encoded), c.bytes); /* Copy the character to the stack */
+    memcpy(HOXML_END(HOXML_STACK) + 1, &(c.encoded), c.bytes); /* Copy the character to the stack */
     HOXML_STACK->end += c.bytes; /* Redirect the end pointer to the new end just after the appended character */
 }
 
@@ -1096,61 +2908,486 @@ void hoxml_append_character(hoxml_context_t* context, hoxml_character_t c) {
 void hoxml_append_terminator(hoxml_context_t* context) {
     size_t bytes;
 
+    if (context->state < HOXML_STATE_NONE) /* Keep the state an earlier error will return to */
+        return;
+    /* If the string ended as a view, it never needs to be copied. Present the view and move on to the next string. */
+    if (HOXML_STACK->flags & HOXML_FLAG_VIEW && context->view != NULL) {
+        hoxml_view_t* view;
+
+        if (context->view_string == &(context->attribute)) { /* If this was an attribute's name */
+            view = &(context->attribute_view);
+            HOXML_STACK->flags |= HOXML_FLAG_ATTRIBUTE_VIEW; /* The name will be copied if the value can't be a view */
+        } else /* This was an attribute's value */
+            view = &(context->value_view);
+        view->data = context->view;
+        view->length = context->view_length;
+        *(context->view_string) = NULL;
+        context->view = NULL;
+        context->view_length = 0;
+        context->view_string = NULL;
+        HOXML_STACK->flags &= ~HOXML_FLAG_VIEW;
+        return;
+    }
+    if (HOXML_STACK->flags & (HOXML_FLAG_VIEW | HOXML_FLAG_ATTRIBUTE_VIEW)) {
+        hoxml_copy_views(context); /* The terminator must follow whatever the views hold */
+        if (context->state < HOXML_STATE_NONE) /* If copying the views was unsuccessful */
+            return;
+    }
+
     if (HOXML_STACK->flags & HOXML_FLAG_TERMINATED) /* If the node's current string is already terminated */
         return; /* To avoid adding additional terminators and using more bytes than expected, do nothing */
     HOXML_STACK->flags |= HOXML_FLAG_TERMINATED;
 
     /* If the document is encoded with UTF-16, two bytes will be appended. One byte otherwise. */
-    bytes = context->encoding == HOXML_ENC_UTF_16_LE || context->encoding == HOXML_ENC_UTF_16_BE ? 2 : 1;
-    if (HOXML_STACK->end + bytes >= context->buffer + context->buffer_length) {
+    bytes = HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+    if (HOXML_END(HOXML_STACK) + bytes >= context->buffer + context->buffer_length) {
         context->error_return_state = context->state;
         context->state = HOXML_STATE_ERROR_INSUFFICIENT_MEMORY;
         return;
     }
 
-    memset(HOXML_STACK->end + 1, '\0', bytes); /* Copy the terminator to the stack */
+    memset(HOXML_END(HOXML_STACK) + 1, '\0', bytes); /* Copy the terminator to the stack */
     HOXML_STACK->end += bytes; /* Redirect the end pointer to the new end just after the appended terminator */
 }
 
+/* Scan ahead through a run of character data, in content, an attribute value, a comment, or a CDATA section, that */
+/* can be accepted without a change of state. The run is copied to the stack's current head node in one step (unless */
+/* it's a comment) and the line and column are updated to match. Parsing continues with the character ending the run. */
+/* UTF-16 runs are transcoded to UTF-8 while they're scanned if the strings on the stack are UTF-8. */
+void hoxml_scan_character_data(hoxml_context_t* context) {
+    const unsigned char* start;
+    const unsigned char* it;
+    const unsigned char* end;
+    unsigned char* out; /* Where transcoded characters are written to the stack, or NULL if not transcoding */
+    unsigned char* out_end;
+    unsigned char delimiter1, delimiter2, delimiter3;
+    int is_appending, is_viewing, is_counting, line, column;
+    unsigned newline_character;
+
+    /* Each state looks for different characters to end the run, some states fewer than three */
+    is_appending = context->state != HOXML_STATE_COMMENT && context->state < HOXML_STATE_SKIP_CONTENT;
+    switch (context->state) {
+    case HOXML_STATE_OPEN_TAG:
+        delimiter1 = '<';
+        delimiter2 = delimiter3 = '&';
+        break;
+    case HOXML_STATE_ATTRIBUTE_VALUE:
+        delimiter1 = '<';
+        delimiter2 = '&';
+        delimiter3 = HOXML_STACK->flags & HOXML_FLAG_DOUBLE_QUOTE ? '"' : '\'';
+        break;
+    case HOXML_STATE_COMMENT:
+    case HOXML_STATE_SKIP_COMMENT:
+        delimiter1 = delimiter2 = delimiter3 = '-';
+        break;
+    case HOXML_STATE_SKIP_CONTENT:
+        delimiter1 = delimiter2 = delimiter3 = '<';
+        break;
+    case HOXML_STATE_SKIP_DOUBLE_QUOTE:
+        delimiter1 = delimiter2 = delimiter3 = '"';
+        break;
+    case HOXML_STATE_SKIP_SINGLE_QUOTE:
+        delimiter1 = delimiter2 = delimiter3 = '\'';
+        break;
+    default: /* HOXML_STATE_CDATA_CONTENT or HOXML_STATE_SKIP_CDATA */
+        delimiter1 = delimiter2 = delimiter3 = ']';
+        break;
+    }
+
+    /* A run continuing the node's view, or starting it, only needs to extend the view. Transcoded runs can't be. */
+    is_viewing = is_appending && HOXML_STACK->flags & HOXML_FLAG_VIEW &&
+        context->string_encoding == context->encoding &&
+        (context->view == NULL || context->view + context->view_length == context->iterator);
+    if (is_appending && !is_viewing && HOXML_STACK->flags & (HOXML_FLAG_VIEW | HOXML_FLAG_ATTRIBUTE_VIEW)) {
+        hoxml_copy_views(context); /* The run must follow whatever the views hold */
+        if (context->state < HOXML_STATE_NONE) /* If copying the views was unsuccessful */
+            return;
+    }
+
+    /* With lazy positions, the run's lines and columns are counted later so newlines needn't end words. What is */
+    /* counted here anyway is undone once the run is scanned. */
+    is_counting = !(context->options & HOXML_OPTION_LAZY_POSITION);
+    line = context->line;
+    column = context->column;
+    newline_character = context->newline_character;
+
+    start = it = (const unsigned char*)context->iterator;
+    end = (const unsigned char*)context->xml + context->xml_length;
+    if (context->budget_end != NULL && end > (const unsigned char*)context->budget_end)
+        end = (const unsigned char*)context->budget_end; /* Don't scan past what hoxml_parse_budget() allows */
+    out = out_end = NULL;
+    /* When copying, don't scan further than the buffer has room for, leaving room for a terminator. The character */
+    /* following the run will then trigger the "insufficient memory" error as it would have without the scan. */
+    if (is_appending && !is_viewing && context->string_encoding != context->encoding) {
+        /* Transcoded characters change length so the room is checked as they're written instead */
+        out = (unsigned char*)HOXML_END(HOXML_STACK) + 1;
+        out_end = (unsigned char*)context->buffer + context->buffer_length - 1;
+    } else if (is_appending && !is_viewing) {
+        size_t room, terminator_bytes;
+
+        terminator_bytes = HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+        room = context->buffer + context->buffer_length - HOXML_END(HOXML_STACK) - 1;
+        room = room > terminator_bytes ? room - terminator_bytes : 0;
+        if ((size_t)(end - start) > room)
+            end = start + room;
+    }
+
+    if (!HOXML_IS_UTF_16(context->encoding)) {
+        while (it < end) {
+            /* Skip whole words of plain ASCII characters at a time. A word is plain if none of its bytes is a */
+            /* delimiter, a newline, a null terminator or, for UTF-8, part of a multi-byte character. */
+            while ((size_t)(end - it) >= sizeof(unsigned long)) {
+                unsigned long word;
+
+                memcpy(&word, it, sizeof(word));
+                if (HOXML_WORD_HAS_ZERO(word) || HOXML_WORD_HAS_BYTE(word, delimiter1) ||
+                        HOXML_WORD_HAS_BYTE(word, delimiter2) || HOXML_WORD_HAS_BYTE(word, delimiter3) ||
+                        (is_counting && (HOXML_WORD_HAS_BYTE(word, 0x0A) || HOXML_WORD_HAS_BYTE(word, 0x0D))) ||
+                        (context->encoding == HOXML_ENC_UTF_8 && (word & HOXML_WORD_HIGHS) != 0))
+                    break;
+                it += sizeof(word);
+                context->column += sizeof(word);
+            }
+            if (it >= end)
+                break;
+
+            /* Then go byte by byte until the word's special byte is dealt with */
+            if (*it == 0 || *it == delimiter1 || *it == delimiter2 || *it == delimiter3)
+                break; /* End of the run */
+            else if (HOXML_IS_NEW_LINE(*it)) {
+                if (context->newline_character == 0) /* If this is the first newline */
+                    context->newline_character = *it; /* Remember this as the character to use for increments */
+                if (*it == context->newline_character) /* Avoid incrementing twice for files with \r\n endings */
+                    context->line++;
+                context->column = 0;
+                it++;
+            } else if (*it < 0x80 || context->encoding == HOXML_ENC_UNKNOWN) {
+                context->column++;
+                it++;
+            } else { /* A multi-byte UTF-8 character */
+                hoxml_character_t c = hoxml_decode_character((const char*)it, end - it, context->encoding);
+
+                /* Leave invalid or overlong characters, and those split by the end of the string, to the usual path */
+                if (c.codepoint < 0x80 || c.codepoint == UINT32_MAX)
+                    break;
+                context->column++;
+                it += c.bytes;
+            }
+        }
+    } else {
+        unsigned long high_bytes; /* Word with all of the more significant bytes of its 16-bit code units set */
+        size_t high, i; /* Index of the more significant byte of a code unit, 1 for UTF-16LE or 0 for UTF-16BE */
+
+        high = context->encoding == HOXML_ENC_UTF_16_LE ? 1 : 0;
+        for (i = 0; i < sizeof(unsigned long); i++)
+            ((unsigned char*)&high_bytes)[i] = (unsigned char)(i % 2 == high ? 0xFF : 0x00);
+        while (end - it >= 2) {
+            hoxml_character_t c;
+            unsigned unit;
+
+            /* Skip whole words of plain ASCII characters at a time, narrowing them to single bytes if transcoding. */
+            /* A word is plain if the more significant byte of every code unit is zero and none of the less */
+            /* significant bytes is a delimiter, a newline, a null terminator, or outside of ASCII's range. */
+            while ((size_t)(end - it) >= sizeof(unsigned long) &&
+                    (out == NULL || out + sizeof(unsigned long) / 2 <= out_end)) {
+                unsigned long word;
+
+                memcpy(&word, it, sizeof(word));
+                if ((word & (HOXML_WORD_HIGHS | high_bytes)) != 0 || HOXML_WORD_HAS_ZERO(word | high_bytes) ||
+                        HOXML_WORD_HAS_BYTE(word, delimiter1) || HOXML_WORD_HAS_BYTE(word, delimiter2) ||
+                        HOXML_WORD_HAS_BYTE(word, delimiter3) ||
+                        (is_counting && (HOXML_WORD_HAS_BYTE(word, 0x0A) || HOXML_WORD_HAS_BYTE(word, 0x0D))))
+                    break;
+                if (out != NULL)
+                    for (i = 1 - high; i < sizeof(word); i += 2)
+                        *(out++) = it[i];
+                it += sizeof(word);
+                context->column += sizeof(word) / 2;
+            }
+            if (end - it < 2)
+                break;
+
+            /* Then go code unit by code unit until the word's special code unit is dealt with */
+            unit = ((unsigned)it[high] << 8) | (unsigned)it[1 - high];
+            if (unit == 0 || unit == delimiter1 || unit == delimiter2 || unit == delimiter3)
+                break; /* End of the run */
+            else if (unit >= 0xD800 && unit <= 0xDFFF)
+                break; /* Leave surrogate pairs, and those split by the end of the string, to the usual path */
+            if (out != NULL) {
+                c = hoxml_encode_character(unit, HOXML_ENC_UTF_8);
+                if (out + c.bytes > out_end) /* If the buffer is full, the usual path will report it */
+                    break;
+                memcpy(out, &(c.encoded), c.bytes);
+                out += c.bytes;
+            }
+            if (HOXML_IS_NEW_LINE(unit)) {
+                if (context->newline_character == 0) /* If this is the first newline */
+                    context->newline_character = unit; /* Remember this as the character to use for increments */
+                if (unit == context->newline_character) /* Avoid incrementing twice for files with \r\n endings */
+                    context->line++;
+                context->column = 0;
+            } else
+                context->column++;
+            it += 2;
+        }
+    }
+
+    if (it == start)
+        return;
+    if (is_viewing) {
+        if (context->view == NULL) { /* If the run is the first part of the string */
+            context->view = (const char*)start;
+            context->view_length = 0;
+        }
+        context->view_length += it - start;
+    } else if (out != NULL) { /* The run was already transcoded to the stack */
+        HOXML_STACK->flags &= ~HOXML_FLAG_TERMINATED;
+        HOXML_STACK->end = (unsigned)((char*)out - 1 - context->stack);
+    } else if (is_appending) {
+        HOXML_STACK->flags &= ~HOXML_FLAG_TERMINATED;
+        memcpy(HOXML_END(HOXML_STACK) + 1, start, it - start); /* Copy the whole run to the stack */
+        HOXML_STACK->end += it - start;
+    }
+    context->iterator = (const char*)it;
+    if (!is_counting) {
+        context->line = line;
+        context->column = column;
+        context->newline_character = newline_character;
+    }
+}
+
+/* Count the lines and columns of the characters between 'position' and the iterator, those found since they were */
+/* last counted, just as hoxml_run() would have as it found them. Only done with lazy positions. Runs of characters */
+/* without newlines are counted a word at a time. */
+void hoxml_count_position(hoxml_context_t* context) {
+    const unsigned char* it;
+    const unsigned char* end;
+
+    if (context->position == NULL)
+        return;
+
+    /* The iterator is only ever behind 'position' when a character pieced together from two strings, and counted */
+    /* as it was found, is to be found again. Nothing is counted until then. */
+    it = (const unsigned char*)context->position;
+    end = (const unsigned char*)context->iterator;
+    context->position = context->iterator;
+    if (HOXML_IS_UTF_16(context->encoding)) {
+        unsigned long high_bytes; /* Word with all of the more significant bytes of its 16-bit code units set */
+        size_t high, i; /* Index of the more significant byte of a code unit, 1 for UTF-16LE or 0 for UTF-16BE */
+
+        high = context->encoding == HOXML_ENC_UTF_16_LE ? 1 : 0;
+        for (i = 0; i < sizeof(unsigned long); i++)
+            ((unsigned char*)&high_bytes)[i] = (unsigned char)(i % 2 == high ? 0xFF : 0x00);
+        for (; end - it >= 2; it += 2) {
+            unsigned unit;
+
+            /* Count whole words of code units below U+8000, so none is half of a surrogate pair, without newlines */
+            while ((size_t)(end - it) >= sizeof(unsigned long)) {
+                unsigned long word;
+
+                memcpy(&word, it, sizeof(word));
+                if ((word & high_bytes & HOXML_WORD_HIGHS) != 0 || HOXML_WORD_HAS_BYTE(word, 0x0A) ||
+                        HOXML_WORD_HAS_BYTE(word, 0x0D))
+                    break;
+                context->column += sizeof(word) / 2;
+                it += sizeof(word);
+            }
+            if (end - it < 2)
+                break;
+
+            /* Then go code unit by code unit until the word's special code unit is dealt with */
+            unit = ((unsigned)it[high] << 8) | (unsigned)it[1 - high];
+            if (HOXML_IS_NEW_LINE(unit)) {
+                if (context->newline_character == 0) /* If this is the first newline */
+                    context->newline_character = unit; /* Remember this as the character to use for increments */
+                if (unit == context->newline_character) /* Avoid incrementing twice for files with \r\n endings */
+                    context->line++;
+                context->column = 0;
+            } else if (unit < 0xDC00 || unit > 0xDFFF) /* The second half of a surrogate pair isn't counted again */
+                context->column++;
+        }
+        return;
+    }
+
+    while (it < end) {
+        /* Count whole words without newlines at a time. With UTF-8, only the bytes that begin characters count, */
+        /* those that aren't 10XXXXXX. Otherwise, every byte is a character. */
+        while ((size_t)(end - it) >= sizeof(unsigned long)) {
+            unsigned long word, starts;
+
+            memcpy(&word, it, sizeof(word));
+            if (HOXML_WORD_HAS_BYTE(word, 0x0A) || HOXML_WORD_HAS_BYTE(word, 0x0D))
+                break;
+            if (context->encoding == HOXML_ENC_UTF_8) {
+                starts = ((~word >> 7) | (word >> 6)) & HOXML_WORD_ONES; /* One in each byte beginning a character */
+                context->column += (int)((starts * HOXML_WORD_ONES) >> ((sizeof(word) - 1) * 8)); /* Sum of them */
+            } else
+                context->column += sizeof(word);
+            it += sizeof(word);
+        }
+        if (it >= end)
+            break;
+
+        /* Then go byte by byte until the word's newline is dealt with */
+        if (HOXML_IS_NEW_LINE(*it)) {
+            if (context->newline_character == 0) /* If this is the first newline */
+                context->newline_character = *it; /* Remember this as the character to use for increments */
+            if (*it == context->newline_character) /* Avoid incrementing twice for files with \r\n endings */
+                context->line++;
+            context->column = 0;
+        } else if (context->encoding != HOXML_ENC_UTF_8 || (*it & 0xC0) != 0x80)
+            context->column++;
+        it++;
+    }
+}
+
+/* Copy any strings that are, so far, only views into the XML content to the stack. This is needed whenever a string */
+/* can no longer be presented as a view, like when a reference is found in it or the XML content is about to change. */
+void hoxml_copy_views(hoxml_context_t* context) {
+    hoxml_node_t* node;
+    size_t bytes;
+
+    if (context->stack == NULL || context->state < HOXML_STATE_NONE) /* Keep the state an earlier error returns to */
+        return;
+
+    /* The name of an attribute is a view if it ended as one. Since the value follows it on the stack, it goes first. */
+    if (HOXML_STACK->flags & HOXML_FLAG_ATTRIBUTE_VIEW) {
+        bytes = HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+        if (HOXML_END(HOXML_STACK) + context->attribute_view.length + bytes >=
+                context->buffer + context->buffer_length) {
+            context->error_return_state = context->state;
+            context->state = HOXML_STATE_ERROR_INSUFFICIENT_MEMORY;
+            return;
+        }
+        context->attribute = HOXML_END(HOXML_STACK) + 1;
+        memcpy(context->attribute, context->attribute_view.data, context->attribute_view.length);
+        memset(context->attribute + context->attribute_view.length, '\0', bytes);
+        HOXML_STACK->end += context->attribute_view.length + bytes;
+        HOXML_STACK->flags = (HOXML_STACK->flags & ~HOXML_FLAG_ATTRIBUTE_VIEW) | HOXML_FLAG_TERMINATED;
+        context->attribute_view.data = NULL;
+        context->attribute_view.length = 0;
+        if (context->value != NULL) /* If the value had begun, it now begins after the name */
+            context->value = HOXML_END(HOXML_STACK) + 1;
+    }
+
+    /* A view usually belongs to the head node but element content may belong to the parent of a close tag's node */
+    node = HOXML_STACK->flags & HOXML_FLAG_VIEW || HOXML_STACK->parent == HOXML_NO_PARENT ? HOXML_STACK :
+        hoxml_parent(context, HOXML_STACK);
+    if (context->view != NULL) {
+        /* Leave room for a terminator after the copy, as appending characters does */
+        bytes = HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+        if (HOXML_END(HOXML_STACK) + context->view_length + bytes >= context->buffer + context->buffer_length) {
+            context->error_return_state = context->state;
+            context->state = HOXML_STATE_ERROR_INSUFFICIENT_MEMORY;
+            return;
+        }
+        if (node != HOXML_STACK) { /* If the view belongs to the parent, move the head node to make room for it */
+            char* old_stack = context->stack;
+
+            memmove(context->stack + context->view_length, context->stack, HOXML_STACK->end + 1);
+            context->stack += context->view_length; /* Its end moves with it, its parent stays where it is */
+            if (context->tag >= old_stack && context->tag <= HOXML_END(HOXML_STACK)) /* If the tag is the head's tag */
+                context->tag += context->view_length;
+        }
+        memcpy(HOXML_END(node) + 1, context->view, context->view_length);
+        if (context->view_string != NULL) /* If a public string should point to the copy */
+            *(context->view_string) = HOXML_END(node) + 1;
+        node->end += context->view_length;
+        node->flags &= ~HOXML_FLAG_TERMINATED;
+        context->view = NULL;
+        context->view_length = 0;
+        context->view_string = NULL;
+    }
+    node->flags &= ~HOXML_FLAG_VIEW; /* Following characters are copied to the stack */
+}
+
+/* Assign the public views to match the public strings, when those strings are on the stack, so that the views are */
+/* all valid when hoxml_parse() returns with the views option. Views into the XML content were assigned already. */
+/* Find the lengths of the public strings without scanning them. They're in the same node, in the order tag, */
+/* attribute, value, content, each beginning just after the terminator of the one before it. The last ends at the */
+/* node's end, before its terminator if the node holds it. XML content can't hold a null character so only a */
+/* terminator ends with a zero code unit. */
+void hoxml_set_lengths(hoxml_context_t* context) {
+    const char* end;
+    size_t bytes;
+
+    bytes = HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+    end = NULL;
+    if (context->tag != NULL)
+        end = HOXML_END(HOXML_NODE_OF(context->tag)) + 1;
+    else if (context->stack != NULL)
+        end = HOXML_END(HOXML_STACK) + 1;
+    #define HOXML_SET_LENGTH(string_length, string) if (string == NULL) \
+            string_length = 0; \
+        else { \
+            string_length = (size_t)(end - string); \
+            if (string_length >= bytes && end[-1] == '\0' && end[-(int)bytes] == '\0') \
+                string_length -= bytes; \
+            end = string - bytes; \
+        }
+    HOXML_SET_LENGTH(context->content_length, context->content)
+    HOXML_SET_LENGTH(context->value_length, context->value)
+    HOXML_SET_LENGTH(context->attribute_length, context->attribute)
+    HOXML_SET_LENGTH(context->tag_length, context->tag)
+    #undef HOXML_SET_LENGTH
+}
+
+void hoxml_set_views(hoxml_context_t* context) {
+    #define HOXML_SET_VIEW(view, string, string_length) if (string != NULL) { \
+            view.data = string; \
+            view.length = string_length; \
+        } \
+        string_length = view.length;
+    HOXML_SET_VIEW(context->tag_view, context->tag, context->tag_length)
+    HOXML_SET_VIEW(context->attribute_view, context->attribute, context->attribute_length)
+    HOXML_SET_VIEW(context->value_view, context->value, context->value_length)
+    HOXML_SET_VIEW(context->content_view, context->content, context->content_length)
+    #undef HOXML_SET_VIEW
+}
+
+/* Match a character of an entity's name against the trie of predefined entities, beginning with the first nodes if */
+/* it's the name's first character or else with the children of the node matched last. Returns 1 and remembers the */
+/* matched node if there was a match, or 0 otherwise. */
+int hoxml_match_entity(hoxml_context_t* context, unsigned codepoint, int is_first) {
+    unsigned node;
+
+    if (is_first)
+        node = 0;
+    else if ((node = hoxml_entity_trie[context->reference_value].child) == 0) /* If the name can't be any longer */
+        return 0;
+    for (;;) {
+        if ((unsigned)(unsigned char)hoxml_entity_trie[node].character == codepoint) {
+            context->reference_value = node;
+            return 1;
+        }
+        if ((node = hoxml_entity_trie[node].sibling) == 0)
+            return 0;
+    }
+}
+
 /* Perform the steps needed to decode and clean up after a character or entity reference given the context obect and */
 /* the type of reference. There are three types defined in an enumeration. */
 void hoxml_end_reference(hoxml_context_t* context, int type) {
     hoxml_character_t c;
-    unsigned long value; /* Integer value of numeric or hexadecimal reference */
     c.codepoint = c.encoded = 0;
     c.bytes = 0;
 
     switch (type) {
     case HOXML_REF_TYPE_ENTITY:
-        if (hoxml_strcmp(context->reference_start, context->encoding, "lt",
-                HOXML_ENC_UNKNOWN, HOXML_CASE_SENSITIVE) != 0) {
-            c = hoxml_encode_character('<', context->encoding);
-        } else if (hoxml_strcmp(context->reference_start, context->encoding, "gt",
-                HOXML_ENC_UNKNOWN, HOXML_CASE_SENSITIVE) != 0) {
-            c = hoxml_encode_character('>', context->encoding);
-        } else if (hoxml_strcmp(context->reference_start, context->encoding, "amp", HOXML_ENC_UNKNOWN,
-                HOXML_CASE_SENSITIVE) != 0) {
-            c = hoxml_encode_character('&', context->encoding);
-        } else if (hoxml_strcmp(context->reference_start, context->encoding, "apos", HOXML_ENC_UNKNOWN,
-                HOXML_CASE_SENSITIVE) != 0) {
-            c = hoxml_encode_character('\'', context->encoding);
-        } else if (hoxml_strcmp(context->reference_start, context->encoding, "quot", HOXML_ENC_UNKNOWN,
-                HOXML_CASE_SENSITIVE) != 0) {
-            c = hoxml_encode_character('"', context->encoding);
-        } else
-            context->state = HOXML_STATE_ERROR_SYNTAX;
-        break;
-    case HOXML_REF_TYPE_NUMERIC:
-        value = strtoul(hoxml_to_ascii(context->reference_start, context->encoding), NULL, 10);
-        if (value != 0) /* If the reference string could be converted as a base-ten integer */
-            c = hoxml_encode_character(value, context->encoding);
+        /* The name matched the trie up to this node but it's only an entity if the name ends here */
+        if (hoxml_entity_trie[context->reference_value].expansion != 0)
+            c = hoxml_encode_character((unsigned)hoxml_entity_trie[context->reference_value].expansion,
+                context->encoding);
         else
             context->state = HOXML_STATE_ERROR_SYNTAX;
         break;
+    case HOXML_REF_TYPE_NUMERIC:
     case HOXML_REF_TYPE_HEX:
-        value = strtoul(hoxml_to_ascii(context->reference_start, context->encoding), NULL, 16);
-        if (value != 0) /* If the reference string could be converted as a base-16 integer */
-            c = hoxml_encode_character(value, context->encoding);
+        /* The value was accumulated as the reference's base-ten or base-16 digits were found. Surrogates are only */
+        /* halves of UTF-16 characters, not characters of their own. */
+        if (context->reference_value != 0 && context->reference_value <= 0x10FFFF &&
+                (context->reference_value < 0xD800 || context->reference_value > 0xDFFF))
+            c = hoxml_encode_character((unsigned)context->reference_value, context->encoding);
         else
             context->state = HOXML_STATE_ERROR_SYNTAX;
         break;
@@ -1160,17 +3397,149 @@ void hoxml_end_reference(hoxml_context_t* context, int type) {
     if (c.bytes == 0)
         return;
 
-    /* Remove the reference's string from the buffer. For example, "&lt;" would result in "lt" being stored so it */
-    /* could be parsed here. It should now be removed from the buffer. */
-    memset(context->reference_start, 0, HOXML_STACK->end - context->reference_start + 1);
-    HOXML_STACK->end = context->reference_start - 1;
-    context->reference_start = NULL;
-    hoxml_append_character(context, c); /* Append the character being referenced */
-    /* No need for any checks against the buffer length. In all cases, more bytes were removed just now than added. */
+    /* Nothing of the reference itself was stored so the character it expands to is appended directly. If there's no */
+    /* room for it, the ';' is parsed again, and the character appended, once there's more room. */
+    hoxml_append_character(context, c);
+    if (context->state < HOXML_STATE_NONE)
+        return;
     context->state = context->return_state; /* Either HOXML_STATE_OPEN_TAG or HOXML_STATE_ATTRIBUTE_VALUE */
     context->return_state = HOXML_STATE_NONE;
 }
 
+/* Parse a character of the document declaration's content (e.g. ' version="1.0" encoding="UTF-8"') as it's found, */
+/* copying the pseudo-attributes' values to the public fields. The first '?' outside of a value ends the content and */
+/* the encoding it names is checked against the document's. Returns zero, with the state set to an error, if the */
+/* character breaks the declaration's grammar or the encoding is contradicted. */
+int hoxml_parse_declaration(hoxml_context_t* context, unsigned codepoint) {
+    /* Pseudo-attributes must be in this order although, unlike the specification, the version isn't required */
+    static const char* const names[] = { "version", "encoding", "standalone" };
+    int name, is_utf_8, is_utf_16;
+
+    switch (context->declaration) {
+    case HOXML_DECLARATION_SPACE: /* Found a closing quote, looking for whitespace or the end */
+    case HOXML_DECLARATION_NAME_BEGIN: /* Found whitespace, looking for a name or the end */
+        if (HOXML_IS_WHITESPACE(codepoint)) {
+            context->declaration = HOXML_DECLARATION_NAME_BEGIN;
+            return 1;
+        } else if (codepoint == '?')
+            break; /* The end, handled below */
+        else if (context->declaration == HOXML_DECLARATION_NAME_BEGIN) {
+            for (name = context->declaration_name + 1; name < 3; name++) {
+                if (codepoint == (unsigned char)names[name][0]) { /* Names are distinguished by their first letter */
+                    context->declaration = HOXML_DECLARATION_NAME;
+                    context->declaration_name = name;
+                    context->declaration_match = names[name];
+                    context->declaration_length = 1;
+                    return 1;
+                }
+            }
+        }
+        context->state = HOXML_STATE_ERROR_INVALID_DOCUMENT_DECLARATION;
+        return 0;
+    case HOXML_DECLARATION_NAME: /* Found the beginning of a name, looking for the rest of it */
+        if (context->declaration_match[context->declaration_length] == '\0' &&
+                (codepoint == '=' || HOXML_IS_WHITESPACE(codepoint))) {
+            context->declaration = codepoint == '=' ? HOXML_DECLARATION_QUOTE : HOXML_DECLARATION_ASSIGNMENT;
+            return 1;
+        } else if (codepoint == (unsigned char)context->declaration_match[context->declaration_length]) {
+            context->declaration_length++;
+            return 1;
+        }
+        context->state = HOXML_STATE_ERROR_INVALID_DOCUMENT_DECLARATION;
+        return 0;
+    case HOXML_DECLARATION_ASSIGNMENT: /* Found a name, looking for '=' */
+    case HOXML_DECLARATION_QUOTE: /* Found '=', looking for a quote */
+        if (HOXML_IS_WHITESPACE(codepoint))
+            return 1;
+        else if (context->declaration == HOXML_DECLARATION_ASSIGNMENT && codepoint == '=') {
+            context->declaration = HOXML_DECLARATION_QUOTE;
+            return 1;
+        } else if (context->declaration == HOXML_DECLARATION_QUOTE && (codepoint == '"' || codepoint == '\'')) {
+            context->declaration = HOXML_DECLARATION_VALUE;
+            context->declaration_quote = codepoint;
+            context->declaration_match = NULL;
+            context->declaration_length = 0;
+            return 1;
+        }
+        context->state = HOXML_STATE_ERROR_INVALID_DOCUMENT_DECLARATION;
+        return 0;
+    case HOXML_DECLARATION_VALUE: /* Found a quote, looking for the value's characters or the closing quote */
+        if (codepoint == context->declaration_quote) { /* The value must not be empty, "1.", or half of "yes" or "no" */
+            context->declaration = HOXML_DECLARATION_SPACE;
+            if (context->declaration_length > (context->declaration_name == 0 ? 2u : 0u) &&
+                    (context->declaration_match == NULL ||
+                    context->declaration_match[context->declaration_length] == '\0'))
+                return 1;
+        } else if (context->declaration_name == 2) { /* standalone="yes" or standalone="no" */
+            if (context->declaration_length == 0 && (codepoint == 'y' || codepoint == 'n')) {
+                context->declaration_match = codepoint == 'y' ? "yes" : "no";
+                context->standalone = codepoint == 'y';
+                context->declaration_length = 1;
+                return 1;
+            } else if (context->declaration_match != NULL &&
+                    codepoint == (unsigned char)context->declaration_match[context->declaration_length]) {
+                context->declaration_length++;
+                return 1;
+            }
+        } else if (context->declaration_name == 0) { /* Versions are "1." followed by digits (e.g. "1.0") */
+            if (context->declaration_length + 1 < sizeof(context->version) && (context->declaration_length < 2 ?
+                    codepoint == (unsigned char)"1."[context->declaration_length] :
+                    (codepoint >= '0' && codepoint <= '9'))) {
+                context->version[context->declaration_length++] = (char)codepoint;
+                context->version[context->declaration_length] = '\0';
+                return 1;
+            }
+        } else { /* Encodings are a few ASCII letters, digits, and punctuation (e.g. "ISO-8859-1") */
+            if (context->declaration_length + 1 < sizeof(context->declared_encoding) && (((codepoint | 0x20) >= 'a' &&
+                    (codepoint | 0x20) <= 'z') || (codepoint >= '0' && codepoint <= '9') || codepoint == '.' ||
+                    codepoint == '_' || codepoint == '-')) {
+                context->declared_encoding[context->declaration_length++] = (char)codepoint;
+                context->declared_encoding[context->declaration_length] = '\0';
+                return 1;
+            }
+        }
+        context->state = HOXML_STATE_ERROR_INVALID_DOCUMENT_DECLARATION;
+        return 0;
+    }
+
+    /* The declaration ended so check the encoding it names, if any, against what's known from the byte order mark */
+    context->declaration = HOXML_DECLARATION_NONE;
+    if (context->declared_encoding[0] == '\0')
+        return 1;
+    is_utf_8 = strlen(context->declared_encoding) == 5 && hoxml_strcmp(context->declared_encoding, HOXML_ENC_UNKNOWN,
+        "UTF-8", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE);
+    is_utf_16 = strlen(context->declared_encoding) == 6 && hoxml_strcmp(context->declared_encoding,
+        HOXML_ENC_UNKNOWN, "UTF-16", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE);
+    switch (context->encoding) {
+    case HOXML_ENC_UNKNOWN: /* The document did not begin with a byte order marker (BOM) */
+        if (is_utf_8) {
+            hoxml_count_position(context); /* Count what's been found as bytes, like before */
+            context->encoding = context->string_encoding = HOXML_ENC_UTF_8;
+        } else if (is_utf_16) {
+            /* UTF-16 encoded documents require one of the UTF-16 BOMs so this is an error */
+            context->state = HOXML_STATE_ERROR_ENCODING;
+            return 0;
+        }
+        break;
+    case HOXML_ENC_UTF_8: /* The UTF-8 BOM was found at the beginning of the document */
+        /* If the UTF-8 BOM was found but the encoding declaration was not "UTF-8" then we have a contradiction and, */
+        /* therefore, an error */
+        if (!is_utf_8) {
+            context->state = HOXML_STATE_ERROR_ENCODING;
+            return 0;
+        }
+        break;
+    case HOXML_ENC_UTF_16_LE: /* The UTF-16LE BOM was found at the beginning of the document */
+    case HOXML_ENC_UTF_16_BE: /* The UTF-16BE BOM was found at the beginning of the document */
+        if (!is_utf_16) {
+            context->state = HOXML_STATE_ERROR_ENCODING;
+            return 0;
+        }
+        break;
+    }
+    return 1;
+}
+
 void hoxml_begin_tag(hoxml_context_t* context) {
     hoxml_push_stack(context);
     if (context->state >= HOXML_STATE_NONE) { /* If pushing a new node was successful */
@@ -1179,28 +3548,94 @@ void hoxml_begin_tag(hoxml_context_t* context) {
     }
 }
 
+/* Set up to parse the document following the one that just ended in a stream, as hoxml_init() would have, but keep */
+/* the buffer, the options, the line and column, and the XML content string and where parsing stopped in it. The */
+/* next document's encoding and newlines are found again, from its own byte order mark and declaration, but UTF-16 */
+/* is kept until then. Its bytes can't be read one at a time, as an unknown encoding's are, without finding zeroes. */
+void hoxml_begin_document(hoxml_context_t* context) {
+    context->tag = context->attribute = context->value = context->content = NULL;
+    context->tag_length = context->attribute_length = context->value_length = context->content_length = 0;
+    context->tag_view.data = context->attribute_view.data = context->value_view.data = NULL;
+    context->content_view.data = NULL;
+    context->tag_view.length = context->attribute_view.length = context->value_view.length = 0;
+    context->content_view.length = 0;
+    context->tag_id = context->attribute_id = HOXML_SYMBOL_NONE;
+    context->version[0] = context->declared_encoding[0] = '\0';
+    context->standalone = -1;
+    context->declaration = HOXML_DECLARATION_NONE;
+    context->depth = context->depth_change = 0;
+    context->consumed = 0;
+    if (!HOXML_IS_UTF_16(context->encoding))
+        context->encoding = context->string_encoding = HOXML_ENC_UNKNOWN;
+    context->view = NULL;
+    context->view_length = 0;
+    context->view_string = NULL;
+    context->state = context->post_state = context->return_state = HOXML_STATE_NONE;
+    context->error_return_state = HOXML_STATE_NONE;
+    context->newline_character = 0;
+    context->skip_depth = 0;
+    context->reference_value = context->name_hash = 0;
+}
+
+/* Push the node standing in for the element a fragment is within. Its content is whatever isn't in its children. */
+void hoxml_begin_fragment(hoxml_context_t* context) {
+    hoxml_push_stack(context);
+    if (context->state < HOXML_STATE_NONE) /* If pushing the node was unsuccessful */
+        return;
+    hoxml_append_terminator(context); /* There's always room for the empty tag's terminator within the node */
+    HOXML_STACK->flags |= HOXML_FLAG_FRAGMENT;
+    context->encoding = context->string_encoding = HOXML_ENC_UTF_8; /* There's no byte order mark to say otherwise */
+    context->state = HOXML_STATE_OPEN_TAG;
+    context->depth = 1; /* The enclosing element is at a depth of zero, like a root, and the fragment is within it */
+    if (context->options & HOXML_OPTION_VIEWS) {
+        HOXML_STACK->flags |= HOXML_FLAG_VIEW;
+        context->view_string = NULL;
+    }
+}
+
 hoxml_code_t hoxml_end_tag(hoxml_context_t* context) {
     hoxml_node_t *node, *parent;
 
     context->state = HOXML_STATE_OPEN_TAG;
     context->post_state = HOXML_POST_STATE_TAG_END; /* Common to three of the four possible cases */
     node = HOXML_STACK;
-    parent = node->parent;
+    parent = hoxml_parent(context, node);
     if (node->flags & HOXML_FLAG_END_TAG) { /* True for e.g. </tag> but not <tag/> */
-        if (parent == NULL || hoxml_strcmp(&(node->tag), context->encoding, &(parent->tag), context->encoding,
-                HOXML_CASE_SENSITIVE) == 0) { /* If there was preceeding open tag or there is but it doesn't match */
+        if (parent != NULL && parent->flags & HOXML_FLAG_FRAGMENT) { /* If it closed the element enclosing a fragment */
+            /* The end tag is popped but its name is left in place, past the new head, until the next call. The */
+            /* cleanup then pops the enclosing element's node, ending the fragment like a document. */
+            hoxml_pop_stack(context);
+            context->tag = &(node->tag);
+            context->view = NULL; /* Only part of the enclosing element's content is known so none of it is kept */
+            context->view_length = 0;
+            parent->flags &= ~HOXML_FLAG_VIEW;
+            context->depth_change = -1;
+            return HOXML_ELEMENT_END;
+        } else if (parent == NULL || (HOXML_NODE_ID(node) != HOXML_SYMBOL_NONE ||
+                /* Names with IDs are the same if their IDs are, otherwise compare them */
+                HOXML_NODE_ID(parent) != HOXML_SYMBOL_NONE ? HOXML_NODE_ID(node) != HOXML_NODE_ID(parent) :
+                hoxml_strcmp(&(node->tag), context->string_encoding, &(parent->tag), context->string_encoding,
+                HOXML_CASE_SENSITIVE) == 0)) { /* If there was no open tag or it differs */
             context->state = HOXML_STATE_ERROR_TAG_MISMATCH;
             return HOXML_ERROR_TAG_MISMATCH;
         } else { /* If an element successfully closed a matching open tag */
             hoxml_pop_stack(context); /* Pop the end tag (e.g. "</tag>") */
             context->tag = &(parent->tag);
-            /* Element content is placed, in memory, after the tag and its terminator... */
-            context->content = context->tag + hoxml_strlen(context->tag, context->encoding);
-            /* ...which may be either one or two bytes, depending on encoding */
-            context->content +=
-                context->encoding == HOXML_ENC_UTF_16_LE || context->encoding == HOXML_ENC_UTF_16_BE ? 2 : 1;
+            if (parent->flags & HOXML_FLAG_VIEW && context->view != NULL) { /* If the content is entirely a view */
+                context->content_view.data = context->view;
+                context->content_view.length = context->view_length;
+                context->view = NULL;
+                context->view_length = 0;
+                parent->flags &= ~HOXML_FLAG_VIEW;
+            } else if (!(context->options & HOXML_OPTION_TEXT)) { /* Unless the content was returned as text */
+                /* Element content is placed, in memory, after the tag and its terminator. The end tag's name, the */
+                /* only string in its node, is the same length as the tag. Its node ends with its terminator. */
+                context->content = context->tag + node->end + 1 - offsetof(hoxml_node_t, tag);
+                /* The content is terminated where the end tag's node was, without adding to the node */
+                memset(HOXML_END(parent) + 1, 0, HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1);
+            }
              /* Closing an element means one less level of nesting so decrement the depth after returning */
-            HOXML_STACK->flags |= HOXML_FLAG_DECREMENT_DEPTH;
+            context->depth_change = -1;
             return HOXML_ELEMENT_END;
         }
     } else if (node->flags & HOXML_FLAG_EMPTY_ELEMENT) /* Self-closing/empty element (e.g. "<tag/>") */
@@ -1209,33 +3644,97 @@ hoxml_code_t hoxml_end_tag(hoxml_context_t* context) {
         return HOXML_PROCESSING_INSTRUCTION_END;
     /* The only remaining case is an open tag (e.g. "<tag>") and we expect a matching close tag later */
     context->post_state = HOXML_STATE_NONE; /* For this fourth case, of four possible, there is no clean up */
+    if (context->options & HOXML_OPTION_VIEWS) { /* The element's content may be presented as a view */
+        node->flags |= HOXML_FLAG_VIEW;
+        context->view_string = NULL;
+    }
     /* Opening an element means one more level of nesting so increment the depth after returning */
-    HOXML_STACK->flags |= HOXML_FLAG_INCREMENT_DEPTH;
+    context->depth_change = 1;
     return HOXML_ELEMENT_BEGIN;
 }
 
+/* Finish skipping an element, returning its "element end" code as if its close tag was parsed like any other */
+hoxml_code_t hoxml_end_skip(hoxml_context_t* context) {
+    context->state = HOXML_STATE_OPEN_TAG;
+    context->post_state = HOXML_POST_STATE_TAG_END;
+    context->tag = &(HOXML_STACK->tag);
+    if (!(HOXML_STACK->flags & HOXML_FLAG_EMPTY_ELEMENT)) /* Empty elements never changed the depth */
+        context->depth_change = -1;
+    return HOXML_ELEMENT_END;
+}
+
+/* Prepare to return the current element's content found so far, if any, with HOXML_TEXT. It will be removed from the */
+/* buffer by the post-state cleanup. Returns 1 if there was content to return or 0 if there wasn't any. */
+int hoxml_end_text(hoxml_context_t* context) {
+    char* content;
+
+    if (HOXML_STACK->flags & HOXML_FLAG_VIEW && context->view != NULL) { /* If the text is a view */
+        context->content_view.data = context->view;
+        context->content_view.length = context->view_length;
+        context->view = NULL;
+        context->view_length = 0;
+        HOXML_STACK->flags &= ~HOXML_FLAG_VIEW;
+    } else {
+        /* Element content is placed, in memory, after the tag and its terminator */
+        content = &(HOXML_STACK->tag) + hoxml_strlen(&(HOXML_STACK->tag), context->string_encoding);
+        content += HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1;
+        if (content > HOXML_END(HOXML_STACK)) /* If there's no content */
+            return 0;
+        context->content = content;
+        /* There's always room to terminate the content after the node without adding to it */
+        memset(HOXML_END(HOXML_STACK) + 1, 0, HOXML_IS_UTF_16(context->string_encoding) ? 2 : 1);
+    }
+    context->tag = &(HOXML_STACK->tag);
+    context->post_state = HOXML_POST_STATE_TEXT_END;
+    return 1;
+}
+
 int hoxml_post_state_cleanup(hoxml_context_t* context) {
     if (context->post_state != HOXML_STATE_NONE) {
         switch (context->post_state) {
         case HOXML_POST_STATE_TAG_END: { /* Clean up after a close tag, empty element, or processing instruction */
-            int was_document_or_document_type_declaration = 0;
-            /* If the processing instruction flag is applied (i.e. this is a PI) and the PI's target is the reserved */
-            /* "xml" target, or some other case variant of it */
-            if (HOXML_STACK->flags & HOXML_FLAG_PROCESSING_INSTRUCTION && hoxml_strcmp(&(HOXML_STACK->tag),
-                    context->encoding, "xml", HOXML_ENC_UNKNOWN, HOXML_CASE_INSENSITIVE)) {
+            int was_in_prolog = 0;
+            /* If the processing instruction flag is applied (i.e. this is a PI) and the PI has no parent, it came */
+            /* before the root element, like the document declaration does. This is decided by where the PI is */
+            /* rather than its target so a target that only begins with "xml" (e.g. "xml-stylesheet") inside an */
+            /* element doesn't send the parser back to the prolog. */
+            if (HOXML_STACK->flags & HOXML_FLAG_PROCESSING_INSTRUCTION && HOXML_STACK->parent == HOXML_NO_PARENT) {
                 context->state = HOXML_STATE_NONE; /* Return to the initial state as if nothing happened */
-                was_document_or_document_type_declaration = 1;
+                was_in_prolog = 1;
             }
             hoxml_pop_stack(context); /* Pop a start or self-closed tag (<tag> or <tag/> or <?pi?>)*/
-            if (context->stack == NULL && was_document_or_document_type_declaration == 0)
+            if (context->stack == NULL && was_in_prolog == 0) {
+                /* The document is done so later calls only return HOXML_END_OF_DOCUMENT, unless it's in a stream */
+                context->state = HOXML_STATE_DONE;
+                context->post_state = HOXML_STATE_NONE;
+                context->consumed = (size_t)(context->iterator - context->xml);
+                hoxml_count_position(context); /* With lazy positions, the document's end is where they're found */
                 return 1; /* hoxml_parse() should return HOXML_END_OF_DOCUMENT */
+            }
+            /* With text codes, the parent's content was all returned already so the following text may be a view */
+            if (context->options & HOXML_OPTION_VIEWS && context->options & HOXML_OPTION_TEXT &&
+                    context->stack != NULL && context->state == HOXML_STATE_OPEN_TAG)
+                HOXML_STACK->flags |= HOXML_FLAG_VIEW;
             break;
         } case HOXML_POST_STATE_ATTRIBUTE_END: /* Remove the most recent attribute and value strings from the buffer */
-            /* Zero the memory from the end pointer to the byte at which the attribute's name begins */
-            memset(context->attribute, 0, HOXML_STACK->end - (char*)context->attribute + 1);
-            HOXML_STACK->end = context->attribute - 1;
-            /* With these public properties now pointing to zeroes, nullify them so there's no confusion */
+            if (context->attribute != NULL) /* If the attribute's name was copied to the stack, not a view */
+                HOXML_STACK->end = (unsigned)(context->attribute - 1 - context->stack); /* Back to before the name */
+            HOXML_STACK->flags &= ~HOXML_FLAG_ATTRIBUTE_VIEW;
+            /* With these public properties now pointing to removed strings, nullify them so there's no confusion */
             context->attribute = context->value = NULL;
+            context->attribute_id = HOXML_SYMBOL_NONE;
+            context->attribute_view.data = context->value_view.data = NULL;
+            context->attribute_view.length = context->value_view.length = 0;
+            break;
+        case HOXML_POST_STATE_TEXT_END: /* Remove the text that was returned from the buffer */
+            if (context->content != NULL) { /* If the text was on the stack, not a view */
+                HOXML_STACK->end = (unsigned)(context->content - 1 - context->stack);
+                context->content = NULL;
+            }
+            context->content_view.data = NULL;
+            context->content_view.length = 0;
+            if (context->options & HOXML_OPTION_VIEWS && context->state == HOXML_STATE_OPEN_TAG)
+                HOXML_STACK->flags |= HOXML_FLAG_VIEW; /* The following text may be a view again */
             break;
         }
         context->post_state = HOXML_STATE_NONE;
@@ -1244,6 +3743,447 @@ int hoxml_post_state_cleanup(hoxml_context_t* context) {
     return 0; /* hoxml_parse() should not return */
 }
 
+/* Look up a name, with the given hash, in the symbol table. The name is the given string of the given length in */
+/* bytes and encoding, not necessarily terminated. Returns the name's ID or HOXML_SYMBOL_NONE if it's not there. */
+int hoxml_find_symbol(const hoxml_symbols_t* symbols, unsigned long hash, const char* str, size_t length,
+        int encoding) {
+    size_t slot;
+
+    slot = hash & (symbols->slot_count - 1);
+    while (symbols->slots[slot] != HOXML_SYMBOL_NONE) {
+        const char *name, *it;
+
+        /* Names with the same hash usually match but they're compared to be sure */
+        name = symbols->names[symbols->slots[slot]];
+        it = str;
+        while (*name != '\0' && it < str + length) {
+            hoxml_character_t c1 = hoxml_decode_character(name, 4, HOXML_ENC_UTF_8);
+            hoxml_character_t c2 = hoxml_decode_character(it, str + length - it, encoding);
+
+            if (c1.codepoint != c2.codepoint || c1.bytes == 0 || c2.bytes == 0)
+                break;
+            name += c1.bytes;
+            it += c2.bytes;
+        }
+        if (*name == '\0' && it == str + length)
+            return symbols->slots[slot];
+        slot = (slot + 1) & (symbols->slot_count - 1);
+    }
+
+    return HOXML_SYMBOL_NONE;
+}
+
+/* Convert the current attribute's value, or the current element's content, to the given type and store it in the */
+/* given field. With HOXML_BIND_ENUM, 'values' holds the acceptable values. Returns 1 if it was stored or 0 if */
+/* there's no value or it couldn't be converted, leaving the field unmodified. */
+int hoxml_convert(const hoxml_context_t* context, int is_content, int type, const hoxml_symbols_t* values,
+        void* field) {
+    const char* str;
+    size_t length;
+
+    if (context->options & HOXML_OPTION_VIEWS)
+        str = is_content ? context->content_view.data : context->value_view.data;
+    else
+        str = is_content ? context->content : context->value;
+    length = is_content ? context->content_length : context->value_length;
+    if (str == NULL)
+        return 0;
+
+    return hoxml_convert_string(str, length, context->string_encoding, type, values, field);
+}
+
+/* Convert the given string, of the given length in bytes and encoding, to the given type and store it in the given */
+/* field. Leading and trailing whitespace is ignored. Returns 1 if it was stored or 0 if it couldn't be converted. */
+int hoxml_convert_string(const char* str, size_t length, int encoding, int type, const hoxml_symbols_t* values,
+        void* field) {
+    char number[HOXML_NUMBER_LENGTH + 1];
+    size_t number_length, unit_length, i;
+    int is_ended;
+
+    /* The strings of a document with no BOM or declared encoding are read as UTF-8, the default, like the names */
+    if (encoding == HOXML_ENC_UNKNOWN)
+        encoding = HOXML_ENC_UTF_8;
+
+    if (type == HOXML_BIND_ENUM) {
+        const char *start, *end, *it;
+        unsigned long hash;
+        hoxml_character_t c;
+        int id;
+
+        if (values == NULL)
+            return 0;
+        /* Find the value without its leading and trailing whitespace, hashing it like the names were */
+        start = end = NULL;
+        for (it = str; it < str + length; it += c.bytes) {
+            c = hoxml_decode_character(it, str + length - it, encoding);
+            if (c.bytes == 0)
+                return 0;
+            if (!HOXML_IS_WHITESPACE(c.codepoint)) {
+                if (start == NULL)
+                    start = it;
+                end = it + c.bytes;
+            }
+        }
+        if (start == NULL) /* If the value is empty or only whitespace */
+            return 0;
+        hash = HOXML_HASH_BASIS;
+        for (it = start; it < end; it += c.bytes) {
+            c = hoxml_decode_character(it, end - it, encoding);
+            hash = HOXML_HASH(hash, c.codepoint);
+        }
+        id = hoxml_find_symbol(values, hash, start, (size_t)(end - start), encoding);
+        if (id == HOXML_SYMBOL_NONE)
+            return 0;
+        *(int*)field = id;
+        return 1;
+    }
+
+    /* Everything else is a number or a word, which may only contain ASCII characters. Those are single bytes in */
+    /* UTF-8 and single units in UTF-16 so they're read from the string without decoding it. */
+    unit_length = HOXML_IS_UTF_16(encoding) ? 2 : 1;
+    number_length = 0;
+    is_ended = 0;
+    for (i = 0; i + unit_length <= length; i += unit_length) {
+        unsigned unit = HOXML_CODE_UNIT(str + i, encoding);
+
+        if (HOXML_IS_WHITESPACE(unit))
+            is_ended = number_length > 0;
+        else if (is_ended || unit > 0x7F || number_length == HOXML_NUMBER_LENGTH)
+            return 0; /* Whitespace within the number, a character that isn't ASCII, or a number far too long */
+        else
+            number[number_length++] = (char)unit;
+    }
+    number[number_length] = '\0';
+    if (number_length == 0) /* If the value is empty or only whitespace */
+        return 0;
+
+    switch (type) {
+    case HOXML_BIND_INT:
+    case HOXML_BIND_UNSIGNED:
+    case HOXML_BIND_LONG:
+    case HOXML_BIND_UNSIGNED_LONG: {
+        unsigned long magnitude, limit;
+        int is_negative;
+
+        /* A negative number's magnitude may be one more than the largest positive number */
+        is_negative = number[0] == '-';
+        if (type == HOXML_BIND_INT)
+            limit = is_negative ? (unsigned long)INT_MAX + 1 : (unsigned long)INT_MAX;
+        else if (type == HOXML_BIND_LONG)
+            limit = is_negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+        else
+            limit = type == HOXML_BIND_UNSIGNED ? UINT_MAX : ULONG_MAX;
+        if (!hoxml_parse_integer(number, number_length, limit, &magnitude))
+            return 0;
+        if (type == HOXML_BIND_INT)
+            *(int*)field = !is_negative ? (int)magnitude : magnitude > INT_MAX ? INT_MIN : -(int)magnitude;
+        else if (type == HOXML_BIND_LONG)
+            *(long*)field = !is_negative ? (long)magnitude : magnitude > LONG_MAX ? LONG_MIN : -(long)magnitude;
+        else if (is_negative && magnitude != 0)
+            return 0;
+        else if (type == HOXML_BIND_UNSIGNED)
+            *(unsigned*)field = (unsigned)magnitude;
+        else
+            *(unsigned long*)field = magnitude;
+        return 1;
+    }
+    case HOXML_BIND_DOUBLE:
+    case HOXML_BIND_FLOAT: {
+        double d;
+
+        if (!hoxml_parse_double(number, number_length, &d))
+            return 0;
+        if (type == HOXML_BIND_DOUBLE)
+            *(double*)field = d;
+        else if (d > FLT_MAX || d < -FLT_MAX)
+            return 0;
+        else
+            *(float*)field = (float)d;
+        return 1;
+    }
+    case HOXML_BIND_BOOL:
+        if (strcmp(number, "true") == 0 || strcmp(number, "1") == 0)
+            *(int*)field = 1;
+        else if (strcmp(number, "false") == 0 || strcmp(number, "0") == 0)
+            *(int*)field = 0;
+        else
+            return 0;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Parse the given decimal integer, an ASCII string of the given length with an optional sign, into its magnitude */
+/* (e.g. 42 for "-42"). Returns 1 if it was parsed or 0 if it's malformed or its magnitude is greater than 'limit'. */
+int hoxml_parse_integer(const char* number, size_t length, unsigned long limit, unsigned long* magnitude) {
+    size_t i;
+
+    i = number[0] == '-' || number[0] == '+' ? 1 : 0;
+    if (i == length) /* If there's only a sign */
+        return 0;
+    for (*magnitude = 0; i < length; i++) {
+        unsigned digit;
+
+        if (!HOXML_IS_NUMERIC(number[i]))
+            return 0;
+        digit = (unsigned)(number[i] - '0');
+        if (*magnitude > (limit - digit) / 10)
+            return 0;
+        *magnitude = *magnitude * 10 + digit;
+    }
+
+    return 1;
+}
+
+/* Parse the given decimal number (e.g. "-1.25e3"), an ASCII string of the given length, into a double. Numbers of up */
+/* to 15 significant digits with small exponents, most of them, are converted exactly with a single multiplication or */
+/* division as both operands are exact. The rest are converted by strtod(), which depends on errno and the locale, */
+/* global state, unlike the rest of hoxml. Returns 1 if it was parsed or 0 if it's malformed or too large for a */
+/* double. */
+int hoxml_parse_double(char* number, size_t length, double* d) {
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+        1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    double mantissa;
+    long exponent, written_exponent;
+    int digits, has_digits, is_written_exponent_negative;
+    size_t i;
+
+    /* Read the digits, before and after any decimal point, into the mantissa while they fit in a double exactly */
+    mantissa = 0.0;
+    exponent = 0;
+    digits = has_digits = 0;
+    for (i = number[0] == '-' || number[0] == '+' ? 1 : 0; i < length && HOXML_IS_NUMERIC(number[i]); i++) {
+        has_digits = 1;
+        if (digits > 0 || number[i] != '0') /* Leading zeros aren't significant */
+            digits++;
+        if (digits <= 15)
+            mantissa = mantissa * 10.0 + (number[i] - '0');
+    }
+    if (i < length && number[i] == '.') {
+        for (i++; i < length && HOXML_IS_NUMERIC(number[i]); i++) {
+            has_digits = 1;
+            if (digits > 0 || number[i] != '0')
+                digits++;
+            if (digits <= 15) {
+                mantissa = mantissa * 10.0 + (number[i] - '0');
+                exponent--;
+            }
+        }
+    }
+    if (!has_digits)
+        return 0;
+    if (i < length && (number[i] == 'e' || number[i] == 'E')) {
+        i++;
+        is_written_exponent_negative = i < length && number[i] == '-';
+        if (i < length && (number[i] == '-' || number[i] == '+'))
+            i++;
+        if (i == length)
+            return 0;
+        for (written_exponent = 0; i < length && HOXML_IS_NUMERIC(number[i]); i++) {
+            if (written_exponent < 100000) /* Far beyond any double, so there's no need to keep counting */
+                written_exponent = written_exponent * 10 + (number[i] - '0');
+        }
+        exponent += is_written_exponent_negative ? -written_exponent : written_exponent;
+    }
+    if (i != length) /* If there's anything else after the number */
+        return 0;
+
+    if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+        *d = exponent < 0 ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+        if (number[0] == '-')
+            *d = -*d;
+    } else {
+        const char* decimal_point;
+        char* number_end;
+
+        /* The decimal point is swapped for the current locale's so strtod() reads it the same way in any locale */
+        decimal_point = localeconv()->decimal_point;
+        if (decimal_point != NULL && decimal_point[0] != '\0' && decimal_point[1] == '\0') {
+            for (i = 0; i < length; i++) {
+                if (number[i] == '.')
+                    number[i] = decimal_point[0];
+            }
+        }
+        errno = 0;
+        *d = strtod(number, &number_end);
+        if (number_end != number + length || (errno == ERANGE && (*d > 1.0 || *d < -1.0)))
+            return 0; /* The number is too large for a double */
+    }
+
+    return 1;
+}
+
+/* Decode the given part of comma-separated integers, of the given length in bytes and encoding, into the decoder's */
+/* array. Integers may continue from one part to the next. */
+void hoxml_decode_csv(hoxml_decoder_t* decoder, const char* str, size_t length, int encoding) {
+    size_t unit_length, i;
+
+    unit_length = HOXML_IS_UTF_16(encoding) ? 2 : 1;
+    for (i = 0; i + unit_length <= length && !decoder->is_error; i += unit_length) {
+        unsigned unit = HOXML_CODE_UNIT(str + i, encoding);
+
+        if (unit >= '0' && unit <= '9') {
+            /* Integers are limited to 32 bits, as they would be in a TMX map, whatever the size of a long */
+            if (decoder->is_ended || decoder->value > (0xFFFFFFFFUL - (unit - '0')) / 10)
+                decoder->is_error = 1;
+            decoder->value = decoder->value * 10 + (unit - '0');
+            decoder->value_length++;
+        } else if (unit == ',') {
+            if (decoder->value_length == 0) /* If the field is empty (e.g. "1,,2") */
+                decoder->is_error = 1;
+            else
+                hoxml_store_value(decoder);
+            decoder->is_separated = 1;
+            decoder->is_ended = 0;
+        } else if (HOXML_IS_WHITESPACE(unit))
+            decoder->is_ended = decoder->value_length > 0;
+        else
+            decoder->is_error = 1;
+    }
+}
+
+/* Decode the given part of base64, of the given length in bytes and encoding, into the decoder's array, four bytes */
+/* to an integer. Groups of four characters, and integers, may continue from one part to the next. */
+void hoxml_decode_base64(hoxml_decoder_t* decoder, const char* str, size_t length, int encoding) {
+    size_t unit_length, i;
+
+    unit_length = HOXML_IS_UTF_16(encoding) ? 2 : 1;
+    for (i = 0; i + unit_length <= length && !decoder->is_error; i += unit_length) {
+        unsigned unit = HOXML_CODE_UNIT(str + i, encoding);
+        unsigned sextet;
+
+        if (unit >= 'A' && unit <= 'Z')
+            sextet = unit - 'A';
+        else if (unit >= 'a' && unit <= 'z')
+            sextet = unit - 'a' + 26;
+        else if (unit >= '0' && unit <= '9')
+            sextet = unit - '0' + 52;
+        else if (unit == '+' || unit == '/')
+            sextet = unit == '+' ? 62 : 63;
+        else {
+            if (unit == '=') {
+                /* Padding ends the data. It's two characters after two of a group and one after three. */
+                if (!decoder->is_ended) {
+                    decoder->is_ended = 1;
+                    decoder->padding = decoder->bit_count == 12 ? 2 : decoder->bit_count == 18 ? 1 : 0;
+                    hoxml_end_base64(decoder);
+                }
+                if (--(decoder->padding) < 0)
+                    decoder->is_error = 1;
+            } else if (!HOXML_IS_WHITESPACE(unit))
+                decoder->is_error = 1;
+            continue;
+        }
+        if (decoder->is_ended) /* If there's data after padding */
+            decoder->is_error = 1;
+        decoder->bits = (decoder->bits << 6) | sextet;
+        decoder->bit_count += 6;
+        if (decoder->bit_count == 24) { /* Every four characters make three bytes */
+            decoder->value |= ((decoder->bits >> 16) & 0xFF) << (8 * decoder->value_length);
+            if (++(decoder->value_length) == 4)
+                hoxml_store_value(decoder);
+            decoder->value |= ((decoder->bits >> 8) & 0xFF) << (8 * decoder->value_length);
+            if (++(decoder->value_length) == 4)
+                hoxml_store_value(decoder);
+            decoder->value |= (decoder->bits & 0xFF) << (8 * decoder->value_length);
+            if (++(decoder->value_length) == 4)
+                hoxml_store_value(decoder);
+            decoder->bits = 0;
+            decoder->bit_count = 0;
+        }
+    }
+}
+
+/* Make the bytes of a short group of base64 characters, two or three of them, which is followed by padding or the */
+/* end of the data */
+void hoxml_end_base64(hoxml_decoder_t* decoder) {
+    int byte_count;
+
+    byte_count = decoder->bit_count / 8;
+    decoder->bits >>= decoder->bit_count % 8; /* The remaining bits only pad the last character */
+    while (byte_count > 0 && !decoder->is_error) {
+        byte_count--;
+        decoder->value |= ((decoder->bits >> (8 * byte_count)) & 0xFF) << (8 * decoder->value_length);
+        if (++(decoder->value_length) == 4)
+            hoxml_store_value(decoder);
+    }
+    decoder->bits = 0;
+    decoder->bit_count = 0;
+}
+
+/* Append the integer that's been decoded to the decoder's array and begin the next one */
+void hoxml_store_value(hoxml_decoder_t* decoder) {
+    if (decoder->value_count == decoder->max_values)
+        decoder->is_error = 1;
+    else
+        decoder->values[decoder->value_count++] = decoder->value;
+    decoder->value = 0;
+    decoder->value_length = 0;
+}
+
+/* Find the given terminator (e.g. "-->") from the given offset and return the offset just past it, or the content's */
+/* length if it isn't found */
+size_t hoxml_split_find(const char* xml, size_t xml_length, size_t from, const char* terminator) {
+    size_t terminator_length;
+
+    terminator_length = strlen(terminator);
+    while (from + terminator_length <= xml_length) {
+        const char* found = (const char*)memchr(xml + from, terminator[0], xml_length - from);
+
+        if (found == NULL)
+            break;
+        from = (size_t)(found - xml);
+        if (from + terminator_length <= xml_length && memcmp(found, terminator, terminator_length) == 0)
+            return from + terminator_length;
+        from++;
+    }
+
+    return xml_length;
+}
+
+/* Find the end of the tag or declaration beginning at the given offset and return the offset just past its '>', or */
+/* the content's length if it isn't found. Quoted values are skipped, as are a declaration's brackets and comments. */
+size_t hoxml_split_tag(const char* xml, size_t xml_length, size_t from) {
+    int brackets;
+
+    brackets = 0;
+    for (from++; from < xml_length; from++) {
+        switch (xml[from]) {
+        case '"':
+        case '\'':
+            from = hoxml_split_find(xml, xml_length, from + 1, xml[from] == '"' ? "\"" : "'") - 1;
+            break;
+        case '[': brackets++; break;
+        case ']': brackets--; break;
+        case '<':
+            if (brackets > 0 && xml_length - from >= 4 && memcmp(xml + from, "<!--", 4) == 0)
+                from = hoxml_split_find(xml, xml_length, from + 4, "-->") - 1;
+            break;
+        case '>':
+            if (brackets <= 0)
+                return from + 1;
+            break;
+        }
+    }
+
+    return xml_length;
+}
+
+/* Find the classes of a codepoint beyond the Latin-1 range in the list of ranges */
+int hoxml_classify_range(unsigned codepoint) {
+    size_t i;
+
+    for (i = 0; i < sizeof(hoxml_character_ranges) / sizeof(hoxml_character_range_t); i++) {
+        if (codepoint < hoxml_character_ranges[i].first) /* If the codepoint falls between this range and the last */
+            break;
+        else if (codepoint <= hoxml_character_ranges[i].last)
+            return hoxml_character_ranges[i].classes;
+    }
+
+    return 0; /* The codepoint isn't part of any range */
+}
+
 /* Decode the given character with the given encoding to the its equivalent value */
 hoxml_character_t hoxml_decode_character(const char* str, size_t str_length, int encoding) {
     hoxml_character_t c;
@@ -1270,7 +4210,8 @@ hoxml_character_t hoxml_decode_character(const char* str, size_t str_length, int
     case HOXML_ENC_UTF_16_BE:
         /* UTF-16 characters are either two bytes or four bytes where the four-byte characters are encoded such that */
         /* the first two bytes begin with 110110XX and the second with 110111XX. The rest are two-byte characters. */
-        if (((str[0] >> 2) & 0x3F) == 0x36 && ((str[2] >> 2) & 0x3F) == 0x37)
+        /* A high surrogate can't be told apart from a lone two-byte character until two more bytes are available. */
+        if (((str[0] >> 2) & 0x3F) == 0x36 && (str_length < 4 || ((str[2] >> 2) & 0x3F) == 0x37))
             c.bytes = 4;
         else
             c.bytes = 2;
@@ -1278,7 +4219,8 @@ hoxml_character_t hoxml_decode_character(const char* str, size_t str_length, int
     case HOXML_ENC_UTF_16_LE:
         /* UTF-16LE (Little Endian) is just like UTF-16BE (Big Endian) but the most and least significant bytes in */
         /* any 16-bit sequence are swapped. (Technically, a byte isn't defined as eight bits but it is in practice.) */
-        if (((str[1] >> 2) & 0x3F) == 0x36 && ((str[3] >> 2) & 0x3F) == 0x37)
+        if (str_length >= 2 && ((str[1] >> 2) & 0x3F) == 0x36 &&
+                (str_length < 4 || ((str[3] >> 2) & 0x3F) == 0x37))
             c.bytes = 4;
         else
             c.bytes = 2;
@@ -1369,7 +4311,7 @@ hoxml_character_t hoxml_encode_character(unsigned codepoint, int encoding) {
             /* order to zero any bits that are not used in the byte being assigned, then shifted all the way to the */
             /* right. The prefixed "0xC0" and "0x80" bitwise ORs prepend the UTF-8 markers 110 and 10, respectively. */
             str[0] = (char)0xC0 | (char)((codepoint & 0x0000007C0) >> 6); /* 110AAAAAA */
-            str[1] = (char)0x80 | (char)((codepoint & 0x0000000FF) >> 0); /* 10BBBBBB */
+            str[1] = (char)0x80 | (char)((codepoint & 0x00000003F) >> 0); /* 10BBBBBB */
             c.bytes = 2;
         } else if ((codepoint >= 0x00000800 && codepoint <= 0x0000D7FF) ||
                 (codepoint >= 0x0000E000 && codepoint <= 0x0000FFFF)) {
@@ -1398,10 +4340,10 @@ hoxml_character_t hoxml_encode_character(unsigned codepoint, int encoding) {
             /* to the form 110110AA BBBBBBBB 110111CC DDDDDDDD. When decoded, as per UTF-16, 0x00010000 is added. */
             /* The prefixed "0xD8" and "0xDC" bitwise ORs prepend the UTF-16 markers 110110 and 110111, respectively. */
             codepoint -= 0x00010000;
-            str[1] = (char)0xD8 | (char)((codepoint & 0x000C0000) >> 18); /* 110110AA */
-            str[0] =              (char)((codepoint & 0x0003FC00) >> 10); /* BBBBBBBB */
-            str[3] = (char)0xDC | (char)((codepoint & 0x00000300) >> 8);  /* 110111CC */
-            str[2] =              (char)((codepoint & 0x000000FF) >> 0);  /* DDDDDDDD */
+            str[0] = (char)0xD8 | (char)((codepoint & 0x000C0000) >> 18); /* 110110AA */
+            str[1] =              (char)((codepoint & 0x0003FC00) >> 10); /* BBBBBBBB */
+            str[2] = (char)0xDC | (char)((codepoint & 0x00000300) >> 8);  /* 110111CC */
+            str[3] =              (char)((codepoint & 0x000000FF) >> 0);  /* DDDDDDDD */
             c.bytes = 4;
         } else /* If the codepoint is not valid */
             c.bytes = 0; /* Don't even try */
@@ -1415,10 +4357,10 @@ hoxml_character_t hoxml_encode_character(unsigned codepoint, int encoding) {
             c.bytes = 2;
         } else if (codepoint >= 0x00010000 && codepoint <= 0x0010FFFF) {
             codepoint -= 0x00010000;
-            str[2] = (char)0xD8 | (char)((codepoint & 0x000C0000) >> 18); /* 110110AA */
-            str[3] =              (char)((codepoint & 0x0003FC00) >> 10); /* BBBBBBBB */
-            str[0] = (char)0xDC | (char)((codepoint & 0x00000300) >> 8);  /* 110111CC */
-            str[1] =              (char)((codepoint & 0x000000FF) >> 0);  /* DDDDDDDD */
+            str[1] = (char)0xD8 | (char)((codepoint & 0x000C0000) >> 18); /* 110110AA */
+            str[0] =              (char)((codepoint & 0x0003FC00) >> 10); /* BBBBBBBB */
+            str[3] = (char)0xDC | (char)((codepoint & 0x00000300) >> 8);  /* 110111CC */
+            str[2] =              (char)((codepoint & 0x000000FF) >> 0);  /* DDDDDDDD */
             c.bytes = 4;
         } else
             c.bytes = 0;
@@ -1428,47 +4370,18 @@ hoxml_character_t hoxml_encode_character(unsigned codepoint, int encoding) {
     return c;
 }
 
-/* Given a reference string with the given encoding, return an equivalent string encoding using ASCII */
-char* hoxml_to_ascii(const char* str, int encoding) {
-    size_t ascii_index;
-    const char* it;
-    hoxml_character_t c;
-
-    /* This is only for references which have a maximum length so this static array will always be large enough */
-    static char ascii[16];
-    memset(ascii, 0, sizeof(ascii));
-
-    ascii_index = 0; /* Current index in the ASCII string */
-    it = str;
-    c = hoxml_decode_character(it, 65535, encoding);
-
-    /* While we haven't iterated up to a null terminator AND not beyond the size of the result array */
-    while (c.codepoint != '\0' && ascii_index < sizeof(ascii)) {
-        /* Assign the decoded value of the source to the equivalent index in the result array. In practice, this is */
-        /* effectively only necessary for UTF-16 content where the encoded values differ from decoded ones for */
-        /* characters also included in ASCII. For UTF-8, this whole function call could be skipped. */
-        ascii[ascii_index++] = c.codepoint;
-
-        /* Iterate to the next character in the string */
-        it += c.bytes;
-        c = hoxml_decode_character(it, 65535, encoding);
-    }
-
-    return ascii;
-}
-
 /* Get the length, in bytes not characters, of the given string with the given encoding */
 size_t hoxml_strlen(const char* str, int encoding) {
-    size_t length = 0;
     const char* it = str;
-    hoxml_character_t c = hoxml_decode_character(it++, 65535, encoding);
 
-    while (c.codepoint != '\0') { /* While we haven't iterated to a null terminator */
-        length++;
-        c = hoxml_decode_character(it++, 65535, encoding);
-    }
+    if (encoding == HOXML_ENC_UNKNOWN || encoding == HOXML_ENC_UTF_8) /* A null terminator is a single zero byte */
+        return strlen(str);
+    /* With UTF-16, a null terminator is a zero code unit. Neither half of a surrogate pair is zero so there's no */
+    /* need to decode characters, only to step over code units. */
+    while (it[0] != '\0' || it[1] != '\0')
+        it += 2;
 
-    return length;
+    return it - str;
 }
 
 /* Compare the given strings with the given encodings for equality with an additional parameter for case sensitivity. */
@@ -1496,32 +4409,6 @@ int hoxml_strcmp(const char* str1, int encoding1, const char* str2, const int en
     return c2.codepoint == '\0';
 }
 
-/* Search for a given string, needle, within another string, haystack. The return value is a pointer to the byte at */
-/* which the string, needle, first appears or NULL if it cannot be found. */
-const char* hoxml_strstr(const char* haystack, int haystack_encoding, const char* needle, int needle_encoding,
-        int sensitivity) {
-    const char* it_haystack = haystack;
-    const char* it_needle = needle;
-    hoxml_character_t c_haystack = hoxml_decode_character(it_haystack, 65535, haystack_encoding);
-    hoxml_character_t c_needle = hoxml_decode_character(it_needle, 65535, needle_encoding);
-
-    while (c_haystack.codepoint != '\0') { /* While we haven't iterated to a null terminator */
-        /* If the current character in the haystack equals the first character in the needle AND the whole needle */
-        /* string follows this character */
-        if (c_haystack.codepoint == c_needle.codepoint &&
-                hoxml_strcmp(it_haystack, haystack_encoding, it_needle, needle_encoding, sensitivity) != 0) {
-            /* Return a pointer to the location the needle (first) appeared at */
-            return it_haystack;
-        }
-
-        /* Continue iterating through characters in the haystack string */
-        it_haystack += c_haystack.bytes;
-        c_haystack = hoxml_decode_character(it_haystack, 65535, haystack_encoding);
-    }
-
-    return NULL; /* The needle was not found in the haystack */
-}
-
 #endif /* HOXML_IMPLEMENTATION */
 
 #endif /* HOXML_H */
@@ -1,178 +1,1342 @@
-#include <stdio.h> /* FILE, fopen(), fprintf(), fread(), fseek(), ftell(), printf(), SEEK_END, SEEK_SET, stderr */
-#include <stdlib.h> /* atoi(), EXIT_FAILURE, EXIT_SUCCESS, free() malloc(), NULL */
-
+/* hoxml is included first so, when compiled with -ansi, it can ask for the POSIX functions it maps files with */
 #define HOXML_IMPLEMENTATION
+#define HOXML_ENABLE_FILE
+#define HOXML_ENABLE_INDEX
 /* #define HOXML_DEBUG */
 #include "hoxml.h"
 
-#define NUM_DOCUMENTS 20
-#define NUM_INVALID_DOCUMENTS 9
+#include <stdio.h> /* FILE, fclose(), fopen(), fprintf(), fread(), fseek(), ftell(), printf(), sprintf(), stderr */
+#include <stdlib.h> /* atoi(), EXIT_FAILURE, EXIT_SUCCESS, free(), malloc(), NULL, realloc() */
+
+#define NUM_DOCUMENTS 35
+#define NUM_INVALID_DOCUMENTS 18
 #define CONTENT_BUFFER_LENGTH 75 /* Small, odd number to force reallocation and to trigger "unexpected EoF" errors */
                                  /* halfway through UTF-16 characters */
+#define STREAM_TRAILER "\r\n\t \n" /* Whitespace after each document of a stream */
+
+/* Flags of a parsing mode that tell which parts of the expected transcript it can't be expected to match */
+enum {
+    MODE_LAST_POSITION = 1, /* Only the last code's line and column, the document's end or an error, are compared */
+    MODE_VALID_ONLY = 2, /* Only valid documents are parsed this way */
+    MODE_NO_POSITIONS = 4, /* Lines and columns aren't compared */
+    MODE_NO_ROOT_CONTENT = 8, /* The root element's content isn't compared */
+    MODE_TWICE = 16, /* The document is parsed twice in a row so a valid document's codes are found twice */
+    MODE_NO_DECLARATION = 32 /* The document declaration's version, encoding, and standalone value aren't compared */
+};
+
+/* Text recording every code found while parsing a document, one line per code, with its line and column and the */
+/* strings that came with it in UTF-8. It's compared to the document's expected transcript. With */
+/* HOXML_OPTION_TEXT, the parts of each element's content are put back together and recorded with its end. */
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+    char* content; /* The parts of the open elements' content found so far, one element's after another's */
+    size_t content_length;
+    size_t content_capacity;
+    size_t content_starts[64]; /* Where each open element's content begins in the content above */
+    int depth;
+} transcript_t;
+
+typedef struct parsing_mode parsing_mode_t;
+
+/* One of the ways a document is parsed. Each should find exactly the codes in the document's expected transcript. */
+struct parsing_mode {
+    const char* name;
+    void (*parse)(const char* path, const parsing_mode_t* mode, transcript_t* transcript);
+    int options; /* Options assigned to the context object */
+    size_t part_length; /* Length of each part of the XML content passed to hoxml, or another limit for the mode */
+    int flags; /* Any number of the MODE_* flags */
+};
+
+/* Append the given bytes to a string, null terminated, growing it as needed */
+static void append_bytes(char** text, size_t* length, size_t* capacity, const char* str, size_t str_length) {
+    if (*length + str_length + 1 > *capacity) {
+        size_t new_capacity = (*length + str_length + 1) * 2;
+        char* new_text = (char*)realloc(*text, new_capacity);
+
+        if (new_text == NULL)
+            return; /* The transcript won't match so there's no need to report it separately */
+        *text = new_text;
+        *capacity = new_capacity;
+    }
+    memcpy(*text + *length, str, str_length);
+    *length += str_length;
+    (*text)[*length] = '\0';
+}
+
+/* Append the given bytes to a transcript */
+static void append(transcript_t* transcript, const char* str, size_t length) {
+    append_bytes(&(transcript->text), &(transcript->length), &(transcript->capacity), str, length);
+}
+
+/* Append a null-terminated string to a transcript */
+static void append_str(transcript_t* transcript, const char* str) {
+    append(transcript, str, strlen(str));
+}
+
+/* Append a string of the given encoding to a transcript, in quotes, as UTF-8 with quotes, backslashes, and control */
+/* characters escaped so every code stays on one line */
+static void append_quoted(transcript_t* transcript, const char* str, size_t length, int encoding) {
+    const char* it;
+    hoxml_character_t c;
+
+    append_str(transcript, "\"");
+    for (it = str; it < str + length; it += c.bytes) {
+        char escaped[8];
+
+        c = hoxml_decode_character(it, str + length - it, encoding == HOXML_ENC_UNKNOWN ? HOXML_ENC_UTF_8 : encoding);
+        if (c.bytes == 0) {
+            append_str(transcript, "(malformed)");
+            break;
+        }
+        if (c.codepoint == '"' || c.codepoint == '\\') {
+            sprintf(escaped, "\\%c", (char)c.codepoint);
+            append_str(transcript, escaped);
+        } else if (c.codepoint == '\n')
+            append_str(transcript, "\\n");
+        else if (c.codepoint == '\r')
+            append_str(transcript, "\\r");
+        else if (c.codepoint == '\t')
+            append_str(transcript, "\\t");
+        else if (c.codepoint < 0x20) {
+            sprintf(escaped, "\\x%02X", c.codepoint);
+            append_str(transcript, escaped);
+        } else {
+            hoxml_character_t utf_8 = hoxml_encode_character(c.codepoint, HOXML_ENC_UTF_8);
+
+            append(transcript, (const char*)&(utf_8.encoded), utf_8.bytes);
+        }
+    }
+    append_str(transcript, "\"");
+}
+
+/* Append one of the context object's strings, or its view with HOXML_OPTION_VIEWS, to a transcript */
+static void append_string(transcript_t* transcript, const hoxml_context_t* context, const char* str, size_t length,
+        hoxml_view_t view) {
+    if (context->options & HOXML_OPTION_VIEWS)
+        append_quoted(transcript, view.data, view.length, context->string_encoding);
+    else
+        append_quoted(transcript, str == NULL ? "" : str, length, context->string_encoding);
+}
+
+/* Check that the lengths of the context object's strings, found without scanning them, are those of the strings */
+static int has_string_lengths(const hoxml_context_t* context) {
+    int encoding = context->string_encoding;
+
+    if (context->options & HOXML_OPTION_VIEWS)
+        return context->tag_length == context->tag_view.length &&
+            context->attribute_length == context->attribute_view.length &&
+            context->value_length == context->value_view.length &&
+            context->content_length == context->content_view.length;
+    return context->tag_length == (context->tag == NULL ? 0 : hoxml_strlen(context->tag, encoding)) &&
+        context->attribute_length == (context->attribute == NULL ? 0 : hoxml_strlen(context->attribute, encoding)) &&
+        context->value_length == (context->value == NULL ? 0 : hoxml_strlen(context->value, encoding)) &&
+        context->content_length == (context->content == NULL ? 0 : hoxml_strlen(context->content, encoding));
+}
+
+/* Add the part of the current element's content just returned with HOXML_TEXT to what's been found of it so far */
+static void record_text(transcript_t* transcript, const hoxml_context_t* context) {
+    if (transcript->depth == 0 || transcript->depth > 64)
+        append_str(transcript, "(text outside of an element)\n");
+    else if (context->options & HOXML_OPTION_VIEWS)
+        append_bytes(&(transcript->content), &(transcript->content_length), &(transcript->content_capacity),
+            context->content_view.data, context->content_view.length);
+    else if (context->content != NULL)
+        append_bytes(&(transcript->content), &(transcript->content_length), &(transcript->content_capacity),
+            context->content, context->content_length);
+    if (context->content_length == 0)
+        append_str(transcript, "(empty text)\n");
+    else if (!has_string_lengths(context))
+        append_str(transcript, "(text with the wrong length)\n");
+}
+
+/* Append the code just returned by the context object, and what came with it, to a transcript */
+static void record_code(transcript_t* transcript, const hoxml_context_t* context, hoxml_code_t code) {
+    char line[128];
+
+    if (code == HOXML_TEXT) { /* Parts of the content aren't recorded until the element ends */
+        record_text(transcript, context);
+        return;
+    }
+    sprintf(line, "%d:%d ", context->line, context->column);
+    append_str(transcript, line);
+    switch (code) {
+    case HOXML_END_OF_DOCUMENT:
+        append_str(transcript, "end-of-document version=");
+        append_quoted(transcript, context->version, strlen(context->version), HOXML_ENC_UTF_8);
+        append_str(transcript, " encoding=");
+        append_quoted(transcript, context->declared_encoding, strlen(context->declared_encoding), HOXML_ENC_UTF_8);
+        sprintf(line, " standalone=%d", context->standalone);
+        append_str(transcript, line);
+        break;
+    case HOXML_ELEMENT_BEGIN:
+        append_str(transcript, "begin ");
+        append_string(transcript, context, context->tag, context->tag_length, context->tag_view);
+        if (context->options & HOXML_OPTION_TEXT && ++(transcript->depth) <= 64)
+            transcript->content_starts[transcript->depth - 1] = transcript->content_length;
+        break;
+    case HOXML_ELEMENT_END:
+        append_str(transcript, "end ");
+        append_string(transcript, context, context->tag, context->tag_length, context->tag_view);
+        if (context->options & HOXML_OPTION_TEXT) {
+            /* The content was returned in parts so there should be none left, only what was put back together */
+            if (context->content_length > 0)
+                append_str(transcript, " (content with HOXML_OPTION_TEXT)");
+            if (transcript->depth > 0 && transcript->depth <= 64) {
+                size_t start = transcript->content_starts[transcript->depth - 1];
+
+                if (transcript->content_length > start) {
+                    append_str(transcript, " ");
+                    append_quoted(transcript, transcript->content + start, transcript->content_length - start,
+                        context->string_encoding);
+                }
+                transcript->content_length = start; /* The parent's content continues from here */
+            }
+            if (transcript->depth > 0)
+                transcript->depth--;
+        } else if (context->content_length > 0) {
+            append_str(transcript, " ");
+            append_string(transcript, context, context->content, context->content_length, context->content_view);
+        }
+        break;
+    case HOXML_ATTRIBUTE:
+        append_str(transcript, "attribute ");
+        append_string(transcript, context, context->tag, context->tag_length, context->tag_view);
+        append_str(transcript, " ");
+        append_string(transcript, context, context->attribute, context->attribute_length, context->attribute_view);
+        append_str(transcript, "=");
+        append_string(transcript, context, context->value, context->value_length, context->value_view);
+        break;
+    case HOXML_PROCESSING_INSTRUCTION_BEGIN:
+        append_str(transcript, "pi-begin ");
+        append_string(transcript, context, context->tag, context->tag_length, context->tag_view);
+        break;
+    case HOXML_PROCESSING_INSTRUCTION_END:
+        append_str(transcript, "pi-end ");
+        append_string(transcript, context, context->tag, context->tag_length, context->tag_view);
+        append_str(transcript, " ");
+        append_string(transcript, context, context->content, context->content_length, context->content_view);
+        break;
+    default:
+        sprintf(line, "error %d", (int)code);
+        append_str(transcript, line);
+        break;
+    }
+    if (code > HOXML_END_OF_DOCUMENT && !has_string_lengths(context))
+        append_str(transcript, " (wrong lengths)");
+    append_str(transcript, "\n");
+}
+
+/* Read the whole file at the given path into allocated memory, null terminated, or return NULL */
+static char* read_file(const char* path, size_t* length) {
+    FILE* file;
+    char* content;
+    long file_length;
+
+    if ((file = fopen(path, "rb")) == NULL)
+        return NULL;
+    fseek(file, 0, SEEK_END); /* Seek to the end of the file */
+    file_length = ftell(file); /* Take the position in the file, the end, as the length */
+    fseek(file, 0, SEEK_SET); /* Seek back to the beginning of the file to read it */
+    content = file_length < 0 ? NULL : (char*)malloc((size_t)file_length + 1);
+    if (content != NULL && fread(content, 1, (size_t)file_length, file) != (size_t)file_length) {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    if (content != NULL) {
+        content[file_length] = '\0';
+        *length = (size_t)file_length;
+    }
+    return content;
+}
+
+/* Parse the file at the given path, read from disk in small parts that are copied to alternating strings, with a */
+/* buffer that's grown as needed. If a growth is given, the buffer begins with that length and grows by it. If not, */
+/* it begins with an eighth of the file's length and doubles. */
+static void parse_in_parts_growing_by(const char* path, const parsing_mode_t* mode, transcript_t* transcript,
+        size_t growth) {
+    FILE* file;
+    size_t hoxml_buffer_length, bytes_read;
+    void* hoxml_buffer;
+    hoxml_context_t hoxml_context;
+    const char* content_pointer;
+    char content[CONTENT_BUFFER_LENGTH], content_copy[CONTENT_BUFFER_LENGTH];
+    hoxml_code_t code;
+
+    if ((file = fopen(path, "rb")) == NULL) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    hoxml_buffer_length = growth;
+    if (growth == 0) {
+        fseek(file, 0, SEEK_END);
+        hoxml_buffer_length = ftell(file) / 8; /* Use a small length to force reallocation */
+        fseek(file, 0, SEEK_SET);
+    }
+    hoxml_buffer = malloc(hoxml_buffer_length);
+    memset(hoxml_buffer, 0xA5, hoxml_buffer_length); /* hoxml shouldn't rely on the buffer being zeroed */
+    hoxml_init(&hoxml_context, hoxml_buffer, hoxml_buffer_length);
+    hoxml_context.options = mode->options;
+
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    content_pointer = content;
+    while (code == HOXML_ERROR_UNEXPECTED_EOF && (bytes_read = fread(content, 1, mode->part_length, file)) != 0) {
+        /* Alternate between two strings so strings can't be read from the previous one after it's replaced */
+        memcpy(content_copy, content, bytes_read);
+        content_pointer = content_pointer == content ? content_copy : content;
+        while ((code = hoxml_parse(&hoxml_context, content_pointer, bytes_read)) != HOXML_ERROR_UNEXPECTED_EOF) {
+            if (code == HOXML_ERROR_INSUFFICIENT_MEMORY) { /* Recoverable error */
+                void* new_buffer;
+
+                /* Recover by growing the buffer and telling hoxml to use it */
+                hoxml_buffer_length = growth == 0 ? hoxml_buffer_length * 2 : hoxml_buffer_length + growth;
+                new_buffer = malloc(hoxml_buffer_length);
+                memset(new_buffer, 0xA5, hoxml_buffer_length); /* Nor the new buffer */
+                hoxml_realloc(&hoxml_context, new_buffer, hoxml_buffer_length);
+                free(hoxml_buffer);
+                hoxml_buffer = new_buffer;
+                continue;
+            }
+            record_code(transcript, &hoxml_context, code);
+            if (code <= HOXML_END_OF_DOCUMENT)
+                break;
+        }
+    }
+    if (code == HOXML_ERROR_UNEXPECTED_EOF) /* The document ended early */
+        record_code(transcript, &hoxml_context, code);
+
+    fclose(file);
+    free(hoxml_buffer);
+}
+
+/* Parse the file at the given path in parts with a buffer that doubles as needed. This is how most programs are */
+/* expected to parse documents. */
+static void parse_in_parts(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    parse_in_parts_growing_by(path, mode, transcript, 0);
+}
+
+/* Parse the file at the given path in parts with a buffer that begins with eight bytes and grows by eight, so it */
+/* runs out at almost every string */
+static void parse_with_small_buffer(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    parse_in_parts_growing_by(path, mode, transcript, 8);
+}
+
+/* Record the codes found by hoxml_parse_sax() */
+static void record_element_begin(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_ELEMENT_BEGIN);
+}
+
+static void record_element_end(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_ELEMENT_END);
+}
+
+static void record_attribute(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_ATTRIBUTE);
+}
+
+static void record_processing_instruction_begin(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_PROCESSING_INSTRUCTION_BEGIN);
+}
+
+static void record_processing_instruction_end(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_PROCESSING_INSTRUCTION_END);
+}
+
+static void record_text_part(hoxml_context_t* context, void* user) {
+    record_code((transcript_t*)user, context, HOXML_TEXT);
+}
+
+static void record_error(hoxml_context_t* context, hoxml_code_t code, void* user) {
+    record_code((transcript_t*)user, context, code);
+}
+
+/* Parse the file at the given path in parts with hoxml_parse_sax(), recording the codes from the callbacks */
+static void parse_with_callbacks(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_context_t hoxml_context;
+    hoxml_sax_t sax;
+    hoxml_code_t code;
+    void* hoxml_buffer;
+    size_t hoxml_buffer_length, xml_length, position;
+    char* xml;
+
+    if ((xml = read_file(path, &xml_length)) == NULL) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    sax.element_begin = record_element_begin;
+    sax.element_end = record_element_end;
+    sax.attribute = record_attribute;
+    sax.processing_instruction_begin = record_processing_instruction_begin;
+    sax.processing_instruction_end = record_processing_instruction_end;
+    sax.text = record_text_part;
+    sax.error = record_error;
+    hoxml_buffer_length = xml_length / 8;
+    hoxml_buffer = malloc(hoxml_buffer_length);
+    hoxml_init(&hoxml_context, hoxml_buffer, hoxml_buffer_length);
+    hoxml_context.options = mode->options;
+
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    for (position = 0; position < xml_length && code == HOXML_ERROR_UNEXPECTED_EOF; position += mode->part_length) {
+        size_t length = xml_length - position < mode->part_length ? xml_length - position : mode->part_length;
+
+        /* Continue, or retry with a bigger buffer, until this part of the document has been parsed */
+        while ((code = hoxml_parse_sax(&hoxml_context, xml + position, length, &sax, transcript)) ==
+                HOXML_ERROR_INSUFFICIENT_MEMORY) {
+            void* new_buffer;
+
+            hoxml_buffer_length *= 2;
+            new_buffer = malloc(hoxml_buffer_length);
+            hoxml_realloc(&hoxml_context, new_buffer, hoxml_buffer_length);
+            free(hoxml_buffer);
+            hoxml_buffer = new_buffer;
+        }
+    }
+    /* Errors were recorded by the callback, the end of the document wasn't */
+    if (code == HOXML_END_OF_DOCUMENT || code == HOXML_ERROR_UNEXPECTED_EOF)
+        record_code(transcript, &hoxml_context, code);
+
+    free(hoxml_buffer);
+    free(xml);
+}
+
+/* Parse the file at the given path with hoxml_file_parse(), all at once */
+static void parse_file(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_file_t file;
+    hoxml_code_t code;
+
+    if (hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    file.context.options = mode->options;
+    do {
+        code = hoxml_file_parse(&file);
+        record_code(transcript, &(file.context), code);
+    } while (code > HOXML_END_OF_DOCUMENT);
+    hoxml_file_close(&file);
+}
+
+/* Split the file at the given path into, at most, the mode's part length of parts and parse each with its own */
+/* context object. All but the last part should end within the root element, the last with the end of the document. */
+/* Each part only holds some of the root element's content so it's never found whole. */
+static void parse_split(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_file_t file;
+    size_t offsets[16], parts, part;
+
+    if (hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    parts = hoxml_split(file.xml, file.xml_length, offsets, mode->part_length);
+    for (part = 0; part < parts; part++) {
+        size_t hoxml_buffer_length, part_length;
+        void* hoxml_buffer;
+        hoxml_context_t hoxml_context;
+        hoxml_code_t code;
+
+        part_length = (part + 1 < parts ? offsets[part + 1] : file.xml_length) - offsets[part];
+        hoxml_buffer_length = 64;
+        hoxml_buffer = malloc(hoxml_buffer_length);
+        hoxml_init(&hoxml_context, hoxml_buffer, hoxml_buffer_length);
+        hoxml_context.options = mode->options | (part > 0 ? HOXML_OPTION_FRAGMENT : 0);
+        while ((code = hoxml_parse(&hoxml_context, file.xml + offsets[part], part_length)) !=
+                HOXML_ERROR_UNEXPECTED_EOF) {
+            if (code == HOXML_ERROR_INSUFFICIENT_MEMORY) {
+                void* new_buffer;
+
+                hoxml_buffer_length *= 2;
+                new_buffer = malloc(hoxml_buffer_length);
+                hoxml_realloc(&hoxml_context, new_buffer, hoxml_buffer_length);
+                free(hoxml_buffer);
+                hoxml_buffer = new_buffer;
+                continue;
+            }
+            record_code(transcript, &hoxml_context, code);
+            if (code <= HOXML_END_OF_DOCUMENT)
+                break;
+        }
+        if (part + 1 < parts && (code != HOXML_ERROR_UNEXPECTED_EOF || hoxml_context.depth != 1))
+            append_str(transcript, "(a part didn't end within the root element)\n");
+        else if (part + 1 == parts && code == HOXML_ERROR_UNEXPECTED_EOF)
+            record_code(transcript, &hoxml_context, code);
+        free(hoxml_buffer);
+    }
+    hoxml_file_close(&file);
+}
+
+/* Names looked up by parse_with_symbols(), some of those found in the documents and some that aren't */
+static const char* const symbol_names[] = { "book", "map", "tileset", "layer", "data", "objectgroup", "object", "note",
+    "from", "to", "doll", "br", "sibling", "id", "name", "gid", "width", "height", "encoding", "version" };
+
+/* Return the index of the given name, which is either a string or a view, in the given names or -1 if it's not there */
+static int find_name(const char* const* names, size_t name_count, const char* str, hoxml_view_t view) {
+    size_t i;
+
+    if (str != NULL) {
+        view.data = str;
+        view.length = strlen(str);
+    }
+    for (i = 0; i < name_count; i++) {
+        if (strlen(names[i]) == view.length && memcmp(names[i], view.data, view.length) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+/* Parse the file at the given path with a symbol table, and UTF-8 strings to compare the names to, and check that */
+/* every tag's and attribute's ID is that of its name */
+static void parse_with_symbols(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    size_t name_count = sizeof(symbol_names) / sizeof(symbol_names[0]);
+    int slots[64];
+    hoxml_symbols_t symbols;
+    hoxml_file_t file;
+    hoxml_code_t code;
+
+    if (hoxml_symbols_init(&symbols, symbol_names, name_count, slots, 64) == 0 || hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    file.context.options = mode->options | HOXML_OPTION_UTF_8;
+    file.context.symbols = &symbols;
+    do {
+        code = hoxml_file_parse(&file);
+        record_code(transcript, &(file.context), code);
+        if ((code == HOXML_ELEMENT_BEGIN || code == HOXML_ELEMENT_END || code == HOXML_ATTRIBUTE) &&
+                file.context.tag_id != find_name(symbol_names, name_count, file.context.tag, file.context.tag_view))
+            append_str(transcript, "(wrong tag ID)\n");
+        if (code == HOXML_ATTRIBUTE && file.context.attribute_id != find_name(symbol_names, name_count,
+                file.context.attribute, file.context.attribute_view))
+            append_str(transcript, "(wrong attribute ID)\n");
+    } while (code > HOXML_END_OF_DOCUMENT);
+    hoxml_file_close(&file);
+}
+
+/* Allocates blocks for context objects set up with hoxml_init_ex(), counting those not yet freed. Like the buffers */
+/* handed to hoxml_init(), the blocks are filled with garbage because hoxml shouldn't rely on them being zeroed. */
+static void* allocate_block(size_t size, void* user) {
+    void* block = malloc(size);
+
+    if (block != NULL) {
+        (*(int*)user)++;
+        memset(block, 0xA5, size);
+    }
+    return block;
+}
+
+/* Frees blocks for context objects set up with hoxml_init_ex() */
+static void release_block(void* memory, void* user) {
+    (*(int*)user)--;
+    free(memory);
+}
+
+/* Set up a context object that allocates its own blocks of the given length, counted by the given integer. Returns */
+/* 0, and notes it in the transcript, if the first block couldn't be allocated. */
+static int init_with_blocks(hoxml_context_t* context, size_t block_length, int* block_count, transcript_t* transcript) {
+    hoxml_allocator_t allocator;
+
+    *block_count = 0;
+    allocator.allocate = allocate_block;
+    allocator.release = release_block;
+    allocator.user = block_count;
+    if (hoxml_init_ex(context, block_length, &allocator) == 0) {
+        append_str(transcript, "(couldn't allocate a block)\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* Free a context object set up with init_with_blocks() and note it in the transcript if a block wasn't freed */
+static void free_blocks(hoxml_context_t* context, const int* block_count, transcript_t* transcript) {
+    hoxml_free(context);
+    if (*block_count != 0)
+        append_str(transcript, "(a block wasn't freed)\n");
+}
+
+/* Parse the file at the given path, in parts, with a context object that allocates its own small blocks. With */
+/* lazy positions, the lines and columns are only up to date after the last code. */
+static void parse_with_blocks(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_context_t hoxml_context;
+    hoxml_code_t code;
+    size_t xml_length, position;
+    char* xml;
+    int block_count;
+
+    if ((xml = read_file(path, &xml_length)) == NULL) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    if (init_with_blocks(&hoxml_context, 64, &block_count, transcript) == 0) {
+        free(xml);
+        return;
+    }
+    hoxml_context.options = mode->options;
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    for (position = 0; position < xml_length && code == HOXML_ERROR_UNEXPECTED_EOF; position += mode->part_length) {
+        size_t length = xml_length - position < mode->part_length ? xml_length - position : mode->part_length;
+
+        while ((code = hoxml_parse(&hoxml_context, xml + position, length)) != HOXML_ERROR_UNEXPECTED_EOF) {
+            record_code(transcript, &hoxml_context, code);
+            if (code <= HOXML_END_OF_DOCUMENT)
+                break;
+        }
+    }
+    if (code == HOXML_ERROR_UNEXPECTED_EOF)
+        record_code(transcript, &hoxml_context, code);
+    free_blocks(&hoxml_context, &block_count, transcript);
+    free(xml);
+}
+
+/* Parse the file at the given path, in parts, with lazy positions and bring the line and column up to date with */
+/* hoxml_position() after every code */
+static void parse_with_lazy_positions(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_context_t hoxml_context;
+    hoxml_code_t code;
+    size_t xml_length, position;
+    char* xml;
+    int block_count;
+
+    if ((xml = read_file(path, &xml_length)) == NULL) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    if (init_with_blocks(&hoxml_context, 1024, &block_count, transcript) == 0) {
+        free(xml);
+        return;
+    }
+    hoxml_context.options = mode->options | HOXML_OPTION_LAZY_POSITION;
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    for (position = 0; position < xml_length && code == HOXML_ERROR_UNEXPECTED_EOF; position += mode->part_length) {
+        size_t length = xml_length - position < mode->part_length ? xml_length - position : mode->part_length;
+
+        while ((code = hoxml_parse(&hoxml_context, xml + position, length)) != HOXML_ERROR_UNEXPECTED_EOF) {
+            hoxml_position(&hoxml_context);
+            record_code(transcript, &hoxml_context, code);
+            if (code <= HOXML_END_OF_DOCUMENT)
+                break;
+        }
+    }
+    if (code == HOXML_ERROR_UNEXPECTED_EOF)
+        record_code(transcript, &hoxml_context, code);
+    free_blocks(&hoxml_context, &block_count, transcript);
+    free(xml);
+}
+
+/* Parse the file at the given path with a budget of a few bytes per call. Parsing should yield at least once. */
+static void parse_with_budget(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_file_t file;
+    hoxml_context_t hoxml_context;
+    hoxml_code_t code;
+    int block_count, yield_count;
+
+    if (hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    if (init_with_blocks(&hoxml_context, 1024, &block_count, transcript) == 0) {
+        hoxml_file_close(&file);
+        return;
+    }
+    hoxml_context.options = mode->options;
+    yield_count = 0;
+    while ((code = hoxml_parse_budget(&hoxml_context, file.xml, file.xml_length, mode->part_length)) >
+            HOXML_END_OF_DOCUMENT) {
+        if (code == HOXML_YIELD)
+            yield_count++;
+        else
+            record_code(transcript, &hoxml_context, code);
+    }
+    record_code(transcript, &hoxml_context, code);
+    if (yield_count == 0)
+        append_str(transcript, "(parsing never yielded)\n");
+    free_blocks(&hoxml_context, &block_count, transcript);
+    hoxml_file_close(&file);
+}
+
+/* Parse a stream of two copies of the file at the given path, in parts, each followed by whitespace in the */
+/* document's encoding. The second document should begin right after the whitespace that follows the first. The */
+/* whitespace after it isn't a third document, only the beginning of one, so parsing should end waiting for more */
+/* content. */
+static void parse_stream(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_context_t hoxml_context;
+    hoxml_code_t code;
+    char *stream, trailer[sizeof(STREAM_TRAILER) * 2];
+    size_t xml_length, trailer_length, stream_length, position, ends[2], i;
+    int end_count, block_count, is_utf_16_le, is_utf_16_be;
+
+    if ((stream = read_file(path, &xml_length)) == NULL) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    /* UTF-16 documents begin with a byte order mark so the whitespace is encoded to match it */
+    is_utf_16_le = xml_length >= 2 && (unsigned char)stream[0] == 0xFF && (unsigned char)stream[1] == 0xFE;
+    is_utf_16_be = xml_length >= 2 && (unsigned char)stream[0] == 0xFE && (unsigned char)stream[1] == 0xFF;
+    trailer_length = 0;
+    for (i = 0; i < strlen(STREAM_TRAILER); i++) {
+        if (is_utf_16_be)
+            trailer[trailer_length++] = '\0';
+        trailer[trailer_length++] = STREAM_TRAILER[i];
+        if (is_utf_16_le)
+            trailer[trailer_length++] = '\0';
+    }
+    stream_length = (xml_length + trailer_length) * 2;
+    if ((stream = (char*)realloc(stream, stream_length)) == NULL) {
+        append_str(transcript, "(couldn't allocate the stream)\n");
+        return;
+    }
+    memcpy(stream + xml_length + trailer_length, stream, xml_length);
+    memcpy(stream + xml_length, trailer, trailer_length);
+    memcpy(stream + xml_length * 2 + trailer_length, trailer, trailer_length);
+    if (init_with_blocks(&hoxml_context, 1024, &block_count, transcript) == 0) {
+        free(stream);
+        return;
+    }
+    hoxml_context.options = mode->options | HOXML_OPTION_STREAM;
+    end_count = 0;
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    for (position = 0; position < stream_length && code == HOXML_ERROR_UNEXPECTED_EOF;
+            position += mode->part_length) {
+        size_t length = stream_length - position < mode->part_length ? stream_length - position : mode->part_length;
+
+        while ((code = hoxml_parse(&hoxml_context, stream + position, length)) != HOXML_ERROR_UNEXPECTED_EOF) {
+            record_code(transcript, &hoxml_context, code);
+            if (code < HOXML_END_OF_DOCUMENT)
+                break;
+            else if (code == HOXML_END_OF_DOCUMENT && end_count++ < 2)
+                ends[end_count - 1] = position + hoxml_context.consumed;
+        }
+    }
+    if (end_count > 2)
+        append_str(transcript, "(more than two documents were found)\n");
+    else if (end_count == 2 && ends[1] != ends[0] + trailer_length + xml_length)
+        append_str(transcript, "(the second document didn't end its length and the whitespace after the first)\n");
+    if (end_count == 2 && code != HOXML_ERROR_UNEXPECTED_EOF)
+        append_str(transcript, "(parsing the whitespace after the last document didn't wait for more content)\n");
+    free_blocks(&hoxml_context, &block_count, transcript);
+    free(stream);
+}
+
+/* Index the file at the given path, with UTF-8 strings, and record its entries like the codes they were made from. */
+/* Entries don't keep lines and columns, or the document declaration, so only the last line and column are known. */
+static void parse_index(const char* path, const parsing_mode_t* mode, transcript_t* transcript) {
+    hoxml_file_t file;
+    hoxml_index_t index;
+    hoxml_code_t code;
+    size_t entry, elements[64];
+    int depth;
+
+    if (hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    code = hoxml_index_build(&index, file.xml, file.xml_length, mode->options | HOXML_OPTION_UTF_8);
+    depth = 0;
+    for (entry = 0; entry < index.entry_count; entry++) {
+        const hoxml_index_entry_t* e = &(index.entries[entry]);
+        hoxml_view_t name, value;
+
+        name = hoxml_index_name(&index, entry);
+        value = hoxml_index_value(&index, entry);
+        append_str(transcript, "0:0 ");
+        switch (e->code) {
+        case HOXML_ELEMENT_BEGIN:
+            append_str(transcript, "begin ");
+            append_quoted(transcript, name.data, name.length, HOXML_ENC_UTF_8);
+            /* Every element's end must be found after its beginning, with the same name, once the document ends */
+            if (code == HOXML_END_OF_DOCUMENT && (e->end <= entry || e->end >= index.entry_count ||
+                    index.entries[e->end].code != HOXML_ELEMENT_END ||
+                    hoxml_index_name(&index, e->end).length != name.length ||
+                    memcmp(hoxml_index_name(&index, e->end).data, name.data, name.length) != 0))
+                append_str(transcript, " (wrong end)");
+            if (depth < 64)
+                elements[depth] = entry;
+            depth++;
+            break;
+        case HOXML_ELEMENT_END:
+            append_str(transcript, "end ");
+            append_quoted(transcript, name.data, name.length, HOXML_ENC_UTF_8);
+            if (value.length > 0) {
+                append_str(transcript, " ");
+                append_quoted(transcript, value.data, value.length, HOXML_ENC_UTF_8);
+            }
+            depth--;
+            break;
+        case HOXML_ATTRIBUTE:
+            append_str(transcript, "attribute ");
+            if (depth > 0 && depth <= 64) {
+                hoxml_view_t tag = hoxml_index_name(&index, elements[depth - 1]);
+
+                append_quoted(transcript, tag.data, tag.length, HOXML_ENC_UTF_8);
+            }
+            append_str(transcript, " ");
+            append_quoted(transcript, name.data, name.length, HOXML_ENC_UTF_8);
+            append_str(transcript, "=");
+            append_quoted(transcript, value.data, value.length, HOXML_ENC_UTF_8);
+            break;
+        case HOXML_PROCESSING_INSTRUCTION_BEGIN:
+            append_str(transcript, "pi-begin ");
+            append_quoted(transcript, name.data, name.length, HOXML_ENC_UTF_8);
+            break;
+        case HOXML_PROCESSING_INSTRUCTION_END:
+            append_str(transcript, "pi-end ");
+            append_quoted(transcript, name.data, name.length, HOXML_ENC_UTF_8);
+            append_str(transcript, " ");
+            append_quoted(transcript, value.data, value.length, HOXML_ENC_UTF_8);
+            break;
+        default:
+            append_str(transcript, "(unknown code)");
+            break;
+        }
+        append_str(transcript, "\n");
+    }
+    if (code == HOXML_END_OF_DOCUMENT) {
+        char line[64];
+
+        sprintf(line, "%d:%d end-of-document\n", index.line, index.column);
+        append_str(transcript, line);
+    } else {
+        char line[64];
+
+        sprintf(line, "%d:%d error %d\n", index.line, index.column, (int)code);
+        append_str(transcript, line);
+    }
+    hoxml_index_free(&index);
+    hoxml_file_close(&file);
+}
+
+/* Find the end of the line that begins at the given position */
+static const char* line_end(const char* line) {
+    while (*line != '\0' && *line != '\n')
+        line++;
+    return line;
+}
+
+/* Skip a line's line and column, which end at the first space */
+static const char* skip_position(const char* line) {
+    const char* it = line;
+
+    while (*it != '\0' && *it != '\n' && *it != ' ')
+        it++;
+    return *it == ' ' ? it + 1 : line;
+}
+
+/* Find the end of an element's end line's tag, where its content begins, or return NULL if it's another code */
+static const char* tag_end(const char* line) {
+    if (strncmp(line, "end \"", 5) != 0)
+        return NULL;
+    for (line += 5; *line != '\0' && *line != '\n' && *line != '"'; line++)
+        ;
+    return *line == '"' ? line + 1 : NULL;
+}
+
+/* Compare a transcript to the expected one, line by line, ignoring what the mode can't be expected to match. Prints */
+/* the first difference and returns 0 if there is one or 1 otherwise. */
+static int compare_transcripts(const char* expected, const char* actual, int flags) {
+    int line_number;
+
+    for (line_number = 1; *expected != '\0' || *actual != '\0'; line_number++) {
+        const char *expected_end, *actual_end, *e, *a, *e_end, *a_end;
+        int is_last, is_root_end, is_prefix;
+
+        expected_end = line_end(expected);
+        actual_end = line_end(actual);
+        is_last = *expected_end == '\0' || expected_end[1] == '\0';
+        is_root_end = !is_last && (*line_end(expected_end + 1) == '\0' || line_end(expected_end + 1)[1] == '\0');
+        e = expected;
+        a = actual;
+        e_end = expected_end;
+        a_end = actual_end;
+        is_prefix = 0; /* Whether only the beginning of the line is compared */
+        if ((flags & MODE_NO_POSITIONS) || ((flags & MODE_LAST_POSITION) && !is_last)) {
+            e = skip_position(e);
+            a = skip_position(a);
+        }
+        if ((flags & MODE_NO_DECLARATION) && strncmp(skip_position(expected), "end-of-document", 15) == 0) {
+            e_end = skip_position(expected) + 15;
+            is_prefix = 1;
+        }
+        if ((flags & MODE_NO_ROOT_CONTENT) && is_root_end && tag_end(e) != NULL) {
+            e_end = tag_end(e);
+            is_prefix = 1;
+        }
+        if (is_prefix)
+            a_end = a + (e_end - e) < actual_end ? a + (e_end - e) : actual_end;
+        if (e_end - e != a_end - a || memcmp(e, a, e_end - e) != 0) {
+            fprintf(stderr, "  Line %d differs:\n    expected: %.*s\n    found:    %.*s\n", line_number,
+                (int)(expected_end - expected), expected, (int)(actual_end - actual), actual);
+            return 0;
+        }
+        expected = *expected_end == '\0' ? expected_end : expected_end + 1;
+        actual = *actual_end == '\0' ? actual_end : actual_end + 1;
+    }
+    return 1;
+}
+
+/* Parse every child of the root element of the file at the given path, skipping them with hoxml_skip_element() as */
+/* they begin */
+static void parse_skipping(const char* path, transcript_t* transcript) {
+    hoxml_file_t file;
+    hoxml_code_t code;
+
+    if (hoxml_file_open(&file, path) == 0) {
+        append_str(transcript, "(couldn't open the document)\n");
+        return;
+    }
+    do {
+        code = hoxml_file_parse(&file);
+        record_code(transcript, &(file.context), code);
+        if (code == HOXML_ELEMENT_BEGIN && file.context.depth == 1 && hoxml_skip_element(&(file.context)) == 0)
+            append_str(transcript, "(couldn't skip the element)\n");
+    } while (code > HOXML_END_OF_DOCUMENT);
+    hoxml_file_close(&file);
+}
+
+/* Check that skipping the root's children leaves out everything nested in them, and their content, but nothing else */
+static int test_skipping(void) {
+    static const char* const expected_lines[] = {
+        "1:6 pi-begin \"xml\"\n",
+        "1:38 pi-end \"xml\" \"version=\\\"1.0\\\" encoding=\\\"UTF-8\\\"\"\n",
+        "2:6 begin \"root\"\n",
+        "3:13 begin \"content\"\n",
+        "3:65 end \"content\"\n",
+        "5:9 pi-begin \"pi\"\n",
+        "5:39 pi-end \"pi\" \"and some meaningless content\"\n",
+        "6:13 begin \"element\"\n",
+        "8:101 end \"element\"\n",
+        "9:24 begin \"predefined_escapes\"\n",
+        "9:70 end \"predefined_escapes\"\n",
+        "10:24 begin \"numeric_references\"\n",
+        "10:70 end \"numeric_references\"\n",
+        "11:20 begin \"hex_references\"\n",
+        "11:67 end \"hex_references\"\n",
+        "12:7 end \"root\" \"\\n    \\n    \\n    \\n    \\n    \\n    \\n    \\n\"\n",
+        "12:7 end-of-document version=\"1.0\" encoding=\"UTF-8\" standalone=-1\n"
+    };
+    transcript_t expected, transcript;
+    size_t i;
+    int is_passed;
+
+    memset(&expected, 0, sizeof(expected));
+    memset(&transcript, 0, sizeof(transcript));
+    for (i = 0; i < sizeof(expected_lines) / sizeof(expected_lines[0]); i++)
+        append_str(&expected, expected_lines[i]);
+    append_str(&transcript, "");
+    parse_skipping("valid_little_bit_of_everything.xml", &transcript);
+    is_passed = compare_transcripts(expected.text, transcript.text, 0);
+    free(expected.text);
+    free(transcript.text);
+    return is_passed;
+}
+
+/* Fields the attributes of valid_values.xml are bound to with hoxml_bind_attribute() */
+typedef struct {
+    unsigned id;
+    unsigned x;
+    double parallax;
+    int orientation;
+    int is_infinite;
+    int version;
+} bound_fields_t;
+
+/* Check that attributes are bound to fields, and rejected when they can't be converted, the same way with or */
+/* without views */
+static int test_binding(int options) {
+    static const char* const names[] = { "object", "id", "x", "parallaxx", "orientation", "infinite", "version",
+        "tile" };
+    static const char* const orientations[] = { "orthogonal", "isometric", "staggered", "hexagonal" };
+    static hoxml_symbols_t orientation_symbols;
+    static const hoxml_binding_t bindings[] = {
+        { -1, 1, HOXML_BIND_UNSIGNED, offsetof(bound_fields_t, id), NULL },
+        { 0, 2, HOXML_BIND_UNSIGNED, offsetof(bound_fields_t, x), NULL },
+        { -1, 3, HOXML_BIND_DOUBLE, offsetof(bound_fields_t, parallax), NULL },
+        { -1, 4, HOXML_BIND_ENUM, offsetof(bound_fields_t, orientation), &orientation_symbols },
+        { -1, 5, HOXML_BIND_BOOL, offsetof(bound_fields_t, is_infinite), NULL },
+        { -1, 6, HOXML_BIND_INT, offsetof(bound_fields_t, version), NULL }
+    };
+    /* What hoxml_bind_attribute() returns for each attribute, in order, then the fields after each element ends */
+    static const int expected_results[] = { 1, 1, 1, 1, 1, -1, 1, -1, 1, -1, -1, 1, 1, 0, 1 };
+    static const bound_fields_t expected_fields[] = {
+        { 35, 160, 0.125, 1, 1, 0 },
+        { 65535, 160, -1500.0, 1, 1, -42 },
+        { 7, 160, -1500.0, 1, 1, -42 },
+        { 7, 160, -1500.0, 1, 0, -42 }
+    };
+    int slots[16], orientation_slots[8];
+    hoxml_symbols_t symbols;
+    bound_fields_t fields;
+    hoxml_file_t file;
+    hoxml_code_t code;
+    size_t result_count, field_count;
+    int is_passed;
+
+    if (hoxml_symbols_init(&symbols, names, 8, slots, 16) == 0 ||
+            hoxml_symbols_init(&orientation_symbols, orientations, 4, orientation_slots, 8) == 0 ||
+            hoxml_file_open(&file, "valid_values.xml") == 0)
+        return 0;
+    file.context.options = options | HOXML_OPTION_UTF_8;
+    file.context.symbols = &symbols;
+    memset(&fields, 0, sizeof(fields));
+    result_count = field_count = 0;
+    is_passed = 1;
+    while ((code = hoxml_file_parse(&file)) > HOXML_END_OF_DOCUMENT && is_passed) {
+        if (code == HOXML_ATTRIBUTE) {
+            int result = hoxml_bind_attribute(&(file.context), bindings, 6, &fields);
+
+            if (result_count >= sizeof(expected_results) / sizeof(expected_results[0]) ||
+                    result != expected_results[result_count++]) {
+                fprintf(stderr, "  Binding attribute %d returned %d\n", (int)result_count, result);
+                is_passed = 0;
+            }
+        } else if (code == HOXML_ELEMENT_END && (file.context.tag_id == 0 || file.context.tag_id == 7) &&
+                field_count < sizeof(expected_fields) / sizeof(expected_fields[0])) {
+            const bound_fields_t* expected = &(expected_fields[field_count++]);
+
+            if (fields.id != expected->id ||
+                    fields.x != expected->x || fields.parallax != expected->parallax ||
+                    fields.orientation != expected->orientation || fields.is_infinite != expected->is_infinite ||
+                    fields.version != expected->version) {
+                fprintf(stderr, "  The fields bound by element %d were %u, %u, %g, %d, %d, %d\n", (int)field_count,
+                    fields.id, fields.x, fields.parallax, fields.orientation, fields.is_infinite, fields.version);
+                is_passed = 0;
+            }
+        }
+    }
+    hoxml_file_close(&file);
+    return is_passed && code == HOXML_END_OF_DOCUMENT &&
+        result_count == sizeof(expected_results) / sizeof(expected_results[0]) &&
+        field_count == sizeof(expected_fields) / sizeof(expected_fields[0]);
+}
+
+/* A number expected to be converted from an attribute's value or element's content */
+typedef struct {
+    int is_long; /* Whether the value or content is a long */
+    long l;
+    int is_double; /* Whether the value or content is a double */
+    double d;
+} expected_number_t;
+
+/* Check that every value and content of valid_values.xml is converted to the expected numbers, or isn't, the same */
+/* way with or without views */
+static int test_conversions(int options) {
+    /* Every attribute, in order, and every element's content as it ends */
+    static const expected_number_t expected_numbers[] = {
+        { 1, 35, 1, 35.0 }, { 1, 160, 1, 160.0 }, { 0, 0, 1, 0.125 }, { 0, 0, 0, 0.0 }, { 0, 0, 0, 0.0 },
+        { 0, 0, 1, 1.8 }, { 0, 0, 0, 0.0 },
+        { 1, 65535, 1, 65535.0 }, { 1, -1, 1, -1.0 }, { 0, 0, 1, -1500.0 }, { 0, 0, 0, 0.0 }, { 0, 0, 0, 0.0 },
+        { 1, -42, 1, -42.0 }, { 0, 0, 0, 0.0 },
+        { 1, 7, 1, 7.0 }, { 1, 3, 1, 3.0 }, { 0, 0, 0, 0.0 },
+        { 0, 0, 0, 0.0 }, { 0, 0, 0, 0.0 },
+        { 0, 0, 0, 0.0 },
+        { 1, -2147483647L, 1, -2147483647.0 }, { 0, 0, 1, 0.0625 }, { 0, 0, 1, 0.1 }, { 0, 0, 0, 0.0 },
+        { 0, 0, 0, 0.0 },
+        { 0, 0, 0, 0.0 }
+    };
+    hoxml_file_t file;
+    hoxml_code_t code;
+    size_t count;
+    int is_passed;
+
+    if (hoxml_file_open(&file, "valid_values.xml") == 0)
+        return 0;
+    file.context.options = options | HOXML_OPTION_UTF_8;
+    count = 0;
+    is_passed = 1;
+    while ((code = hoxml_file_parse(&file)) > HOXML_END_OF_DOCUMENT && is_passed) {
+        const expected_number_t* expected;
+        int is_long, is_double;
+        long l;
+        double d;
+
+        if (code == HOXML_ATTRIBUTE) {
+            is_long = hoxml_value_as_long(&(file.context), &l);
+            is_double = hoxml_value_as_double(&(file.context), &d);
+        } else if (code == HOXML_ELEMENT_END) {
+            is_long = hoxml_content_as_long(&(file.context), &l);
+            is_double = hoxml_content_as_double(&(file.context), &d);
+        } else
+            continue;
+        if (count >= sizeof(expected_numbers) / sizeof(expected_numbers[0])) {
+            is_passed = 0;
+            break;
+        }
+        expected = &(expected_numbers[count++]);
+        if (is_long != expected->is_long || is_double != expected->is_double || (is_long && l != expected->l) ||
+                (is_double && d != expected->d)) {
+            fprintf(stderr, "  Conversion %d found %d, %ld, %d, %.17g\n", (int)count, is_long, is_long ? l : 0,
+                is_double, is_double ? d : 0.0);
+            is_passed = 0;
+        }
+    }
+    hoxml_file_close(&file);
+    return is_passed && code == HOXML_END_OF_DOCUMENT &&
+        count == sizeof(expected_numbers) / sizeof(expected_numbers[0]);
+}
+
+/* Parse the given XML content, passing it in parts of the given length, with HOXML_OPTION_TEXT and decode the */
+/* content of every "data" element in parts, as it's found, with the given format. Returns the number of integers */
+/* decoded, into the given array, or -1 if the document couldn't be parsed or the content couldn't be decoded. */
+static int decode_data(const char* xml, size_t xml_length, size_t part_length, int format, unsigned long* values,
+        size_t max_values) {
+    hoxml_context_t hoxml_context;
+    hoxml_decoder_t decoder;
+    hoxml_code_t code;
+    char hoxml_buffer[256]; /* Small so the content never fits in the buffer at once */
+    size_t position, count;
+    int is_decoded;
+
+    count = 0;
+    is_decoded = 1;
+    code = HOXML_ERROR_UNEXPECTED_EOF;
+    hoxml_init(&hoxml_context, hoxml_buffer, sizeof(hoxml_buffer));
+    hoxml_context.options = HOXML_OPTION_TEXT;
+    for (position = 0; position < xml_length && code == HOXML_ERROR_UNEXPECTED_EOF; position += part_length) {
+        size_t length = xml_length - position < part_length ? xml_length - position : part_length;
+
+        while ((code = hoxml_parse(&hoxml_context, xml + position, length)) > HOXML_END_OF_DOCUMENT) {
+            if (code == HOXML_ELEMENT_BEGIN && strcmp(hoxml_context.tag, "data") == 0)
+                hoxml_decoder_init(&decoder, format, values + count, max_values - count);
+            else if (code == HOXML_TEXT && strcmp(hoxml_context.tag, "data") == 0 &&
+                    !hoxml_decoder_decode(&decoder, &hoxml_context))
+                is_decoded = 0;
+            else if (code == HOXML_ELEMENT_END && strcmp(hoxml_context.tag, "data") == 0) {
+                if (!hoxml_decoder_finish(&decoder))
+                    is_decoded = 0;
+                count += decoder.value_count;
+            }
+        }
+    }
+
+    return code == HOXML_END_OF_DOCUMENT && is_decoded ? (int)count : -1;
+}
+
+/* Decode the given XML content in parts of several lengths and check that the expected integers are found each time */
+static int is_decoded(const char* xml, size_t xml_length, int format, const unsigned long* expected_values,
+        size_t expected_count) {
+    static unsigned long values[4096];
+    static const size_t part_lengths[] = { 1, 7, CONTENT_BUFFER_LENGTH, 100000 };
+    size_t i;
+
+    for (i = 0; i < sizeof(part_lengths) / sizeof(part_lengths[0]); i++) {
+        if (decode_data(xml, xml_length, part_lengths[i], format, values, 4096) != (int)expected_count ||
+                memcmp(values, expected_values, expected_count * sizeof(values[0])) != 0) {
+            fprintf(stderr, "  Decoding in parts of %lu bytes didn't find the expected %lu integers\n",
+                (unsigned long)part_lengths[i], (unsigned long)expected_count);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Check that CSV and base64 data is decoded into the expected integers however it's split into parts */
+static int test_decoding(void) {
+    static const char* csv = "<data>\n1,2, 3,\n4294967295,0\n</data>";
+    static const unsigned long csv_values[] = { 1, 2, 3, 4294967295UL, 0 };
+    static const char* base64 = "<data>\n  AQAAAAIAAAD/\n  ////\n</data>";
+    static const unsigned long base64_values[] = { 1, 2, 0xFFFFFFFFUL };
+    static unsigned long values[4096], expected_values[1000];
+    static char encoded[1000 * 6 + 16];
+    static const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    hoxml_file_t file;
+    size_t length, i;
+    int count, one_count;
+
+    if (!is_decoded(csv, strlen(csv), HOXML_DATA_CSV, csv_values, 5) ||
+            !is_decoded(base64, strlen(base64), HOXML_DATA_BASE64, base64_values, 3))
+        return 0;
+
+    /* Encode integers spread across all four bytes, so the bytes' order matters, as base64 and decode them again */
+    for (i = 0; i < 1000; i++)
+        expected_values[i] = (i * 2654435761UL) & 0xFFFFFFFFUL;
+    length = sprintf(encoded, "<data>");
+    for (i = 0; i < 1000 * 4; i += 3) {
+        unsigned long bits;
+        size_t byte, byte_count;
+
+        byte_count = 1000 * 4 - i < 3 ? 1000 * 4 - i : 3;
+        for (bits = 0, byte = i; byte < i + 3; byte++) {
+            bits <<= 8;
+            if (byte < i + byte_count)
+                bits |= (expected_values[byte / 4] >> (8 * (byte % 4))) & 0xFF;
+        }
+        encoded[length++] = digits[(bits >> 18) & 0x3F];
+        encoded[length++] = digits[(bits >> 12) & 0x3F];
+        encoded[length++] = byte_count > 1 ? digits[(bits >> 6) & 0x3F] : '=';
+        encoded[length++] = byte_count > 2 ? digits[bits & 0x3F] : '=';
+        if (i % 57 == 54) /* Break lines like most encoders do */
+            encoded[length++] = '\n';
+    }
+    length += sprintf(encoded + length, "</data>");
+    if (!is_decoded(encoded, length, HOXML_DATA_BASE64, expected_values, 1000))
+        return 0;
+
+    /* The tile map's layer is 40 by 16 tiles, 22 of them platforms */
+    if (hoxml_file_open(&file, "valid_tilemap.tmx") == 0)
+        return 0;
+    count = decode_data(file.xml, file.xml_length, CONTENT_BUFFER_LENGTH, HOXML_DATA_CSV, values, 4096);
+    hoxml_file_close(&file);
+    for (i = 0, one_count = 0; count > 0 && i < (size_t)count; i++)
+        one_count += values[i] == 1;
+    return count == 40 * 16 && one_count == 22 && values[40 * 6 + 23] == 1 && values[40 * 13 + 27] == 1;
+}
+
+/* The ways each document is parsed. The first is printed as it's parsed. */
+static const parsing_mode_t modes[] = {
+    { "in parts", parse_in_parts, 0, CONTENT_BUFFER_LENGTH - 1, 0 },
+    { "one byte at a time", parse_in_parts, 0, 1, 0 }, /* Splits every multibyte character between strings */
+    { "in parts of three bytes", parse_in_parts, 0, 3, 0 }, /* Splits them at every other byte too */
+    { "in parts with views", parse_in_parts, HOXML_OPTION_VIEWS, CONTENT_BUFFER_LENGTH - 1, 0 },
+    { "one byte at a time with views", parse_in_parts, HOXML_OPTION_VIEWS, 1, 0 }, /* No string fits in one view */
+    { "in parts with views and a small buffer", parse_with_small_buffer, HOXML_OPTION_VIEWS,
+        CONTENT_BUFFER_LENGTH - 1, 0 },
+    { "with callbacks", parse_with_callbacks, 0, CONTENT_BUFFER_LENGTH, 0 },
+    { "as text", parse_in_parts, HOXML_OPTION_TEXT, CONTENT_BUFFER_LENGTH - 1, 0 },
+    { "as text one byte at a time with views", parse_in_parts, HOXML_OPTION_TEXT | HOXML_OPTION_VIEWS, 1, 0 },
+    { "as text with callbacks", parse_with_callbacks, HOXML_OPTION_TEXT, CONTENT_BUFFER_LENGTH, 0 },
+    { "as text with a budget and views", parse_with_budget, HOXML_OPTION_TEXT | HOXML_OPTION_VIEWS, 5, 0 },
+    { "as a whole file", parse_file, 0, 0, 0 },
+    { "with UTF-8 strings", parse_file, HOXML_OPTION_UTF_8, 0, 0 },
+    { "in parts of three bytes with UTF-8 strings", parse_in_parts, HOXML_OPTION_UTF_8, 3, 0 }, /* And surrogates */
+    { "split into parts", parse_split, 0, 8,
+        MODE_VALID_ONLY | MODE_NO_POSITIONS | MODE_NO_ROOT_CONTENT | MODE_NO_DECLARATION },
+    { "with symbols", parse_with_symbols, 0, 0, 0 },
+    { "with symbols and views", parse_with_symbols, HOXML_OPTION_VIEWS, 0, 0 },
+    { "with allocated blocks", parse_with_blocks, 0, 7, 0 },
+    { "with allocated blocks and views", parse_with_blocks, HOXML_OPTION_VIEWS, 7, 0 },
+    { "with a budget", parse_with_budget, 0, 5, 0 },
+    { "with a budget and views", parse_with_budget, HOXML_OPTION_VIEWS, 5, 0 },
+    { "with lazy positions", parse_with_lazy_positions, 0, 7, 0 },
+    { "with lazy positions left to the end", parse_with_blocks, HOXML_OPTION_LAZY_POSITION, 1000, MODE_LAST_POSITION },
+    { "twice in a stream", parse_stream, 0, 7, MODE_NO_POSITIONS | MODE_TWICE },
+    { "as an index", parse_index, 0, 0, MODE_LAST_POSITION | MODE_NO_DECLARATION }
+};
 
 int main(int argc, char** argv) {
     char* documents[NUM_DOCUMENTS];
-    int from, to, document_index;
+    int from, to, document_index, failure_count;
+    size_t mode_index;
 
     /* These documents are expected to return errors */
     documents[0]  = "invalid_doctype.xml";
     documents[1]  = "invalid_document_declaration.xml";
-    documents[2]  = "invalid_encoding.xml";
-    documents[3]  = "invalid_syntax_cdata.xml";
-    documents[4]  = "invalid_syntax_close_and_self_close.xml";
-    documents[5]  = "invalid_syntax_name_char.xml";
-    documents[6]  = "invalid_syntax_quotation_mismatch.xml";
-    documents[7]  = "invalid_syntax_reference.xml";
-    documents[8]  = "invalid_tag_mismatch.xml";
+    documents[2]  = "invalid_document_declaration_duplicate.xml";
+    documents[3]  = "invalid_document_declaration_order.xml";
+    documents[4]  = "invalid_document_declaration_standalone.xml";
+    documents[5]  = "invalid_document_declaration_version.xml";
+    documents[6]  = "invalid_encoding.xml";
+    documents[7]  = "invalid_syntax_cdata.xml";
+    documents[8]  = "invalid_syntax_close_and_self_close.xml";
+    documents[9]  = "invalid_syntax_name_char.xml";
+    documents[10] = "invalid_syntax_name_start_char.xml";
+    documents[11] = "invalid_syntax_quotation_mismatch.xml";
+    documents[12] = "invalid_syntax_reference.xml";
+    documents[13] = "invalid_syntax_reference_decimal_overflow.xml";
+    documents[14] = "invalid_syntax_reference_entity.xml";
+    documents[15] = "invalid_syntax_reference_hex_overflow.xml";
+    documents[16] = "invalid_syntax_reference_surrogate.xml";
+    documents[17] = "invalid_tag_mismatch.xml";
     /* These documents are expected to be parsed successfully */
-    documents[9]  = "valid_basic.xml";
-    documents[10] = "valid_cdata.xml";
-    documents[11] = "valid_comments.xml";
-    documents[12] = "valid_doctype.xml";
-    documents[13] = "valid_encoding_utf8.xml";
-    documents[14] = "valid_encoding_utf16be.xml";
-    documents[15] = "valid_encoding_utf16le.xml";
-    documents[16] = "valid_little_bit_of_everything.xml";
-    documents[17] = "valid_nesting.xml";
-    documents[18] = "valid_references.xml";
-    documents[19] = "valid_tilemap.tmx";
+    documents[18] = "valid_basic.xml";
+    documents[19] = "valid_cdata.xml";
+    documents[20] = "valid_comments.xml";
+    documents[21] = "valid_doctype.xml";
+    documents[22] = "valid_document_declaration.xml";
+    documents[23] = "valid_empty_attributes.xml";
+    documents[24] = "valid_encoding_utf8.xml";
+    documents[25] = "valid_encoding_utf16be.xml";
+    documents[26] = "valid_encoding_utf16le.xml";
+    documents[27] = "valid_encoding_utf16le_names.xml";
+    documents[28] = "valid_little_bit_of_everything.xml";
+    documents[29] = "valid_name_chars.xml";
+    documents[30] = "valid_nesting.xml";
+    documents[31] = "valid_processing_instructions.xml";
+    documents[32] = "valid_references.xml";
+    documents[33] = "valid_tilemap.tmx";
+    documents[34] = "valid_values.xml";
 
     from = 0;
     to = NUM_DOCUMENTS - 1;
     if (argc > 1) /* If a specific index was passed as a CLI argument */
         from = to = atoi(argv[1]); /* No sanitation here. You're a programmer. Be smart. */
 
+    failure_count = 0;
     for (document_index = from; document_index <= to; document_index++) {
-        FILE* file;
-        size_t content_length, hoxml_buffer_length, bytes_read;
-        void* hoxml_buffer;
-        hoxml_context_t hoxml_context;
-        const char* content_pointer;
-        char content[CONTENT_BUFFER_LENGTH], content_copy[CONTENT_BUFFER_LENGTH];
+        char expected_path[64];
+        char *expected, *twice;
+        size_t expected_length;
+        int is_valid = document_index >= NUM_INVALID_DOCUMENTS;
 
-        if ((file = fopen(documents[document_index], "r")) == NULL) {
-            fprintf(stderr, "Couldn't open document \"%s\"\n", documents[document_index]);
-            return EXIT_FAILURE;
+        /* Every document has a transcript of the codes it's expected to return, named after it */
+        sprintf(expected_path, "%.*s.txt", (int)(strrchr(documents[document_index], '.') - documents[document_index]),
+            documents[document_index]);
+        printf("\n\n\n  --------- Parsing XML document \"%s\"\n", documents[document_index]);
+        if ((expected = read_file(expected_path, &expected_length)) == NULL) {
+            fprintf(stderr, "\n\n  Couldn't read the expected transcript \"%s\"\n", expected_path);
+            failure_count++;
+            continue;
         }
+        /* In a stream, a valid document is parsed again right after it ends */
+        twice = (char*)malloc(expected_length * 2 + 1);
+        sprintf(twice, "%s%s", expected, is_valid ? expected : "");
 
-        fseek(file, 0, SEEK_END); /* Seek to the end of the file */
-        content_length = ftell(file); /* Take the position in the file, the end, as the length */
-        fseek(file, 0, SEEK_SET); /* Seek back to the beginning of the file to iterate through it */
-        printf("\n\n\n  --------- Parsing XML document \"%s\" of length %lu\n", documents[document_index],
-            (unsigned long)content_length);
+        for (mode_index = 0; mode_index < sizeof(modes) / sizeof(modes[0]); mode_index++) {
+            const parsing_mode_t* mode = &(modes[mode_index]);
+            transcript_t transcript;
 
-        hoxml_buffer_length = content_length / 8; /* Use a small length to force multiple line reads */
-        hoxml_buffer = malloc(hoxml_buffer_length);
-        hoxml_init(&hoxml_context, hoxml_buffer, hoxml_buffer_length);
-        printf("  --- Using an initial buffer length of %lu\n", (unsigned long)hoxml_buffer_length);
-
-        content_pointer = content;
-        while ((bytes_read = fread(content, 1, CONTENT_BUFFER_LENGTH - 1, file)) != 0) {
-            int is_done_with_document;
-
-            content[bytes_read] = '\0';
-            memcpy(content_copy, content, bytes_read);
-            content_pointer = content_pointer == content ? content_copy : content;
-            is_done_with_document = 0;
-            while (is_done_with_document == 0) {
-                hoxml_code_t code;
-
-                code = hoxml_parse(&hoxml_context, content_pointer, bytes_read);
-                if (code < HOXML_END_OF_DOCUMENT) { /* If an error was returned */
-                    if (code == HOXML_ERROR_UNEXPECTED_EOF) { /* Recoverable error */
-                        /* Recover by exiting this loop leading to more XML content being read from disk */
-                        printf("  --- Parsed to end of the current content buffer - continuing to next string...\n");
-                        break;
-                    } else if (code == HOXML_ERROR_INSUFFICIENT_MEMORY) { /* Recoverable error */
-                        void* new_buffer;
-
-                        /* Recover by doubling the size of the buffer and telling hoxml to use it */
-                        printf("  --- Ran out of memory - increasing buffer from %lu to %lu\n",
-                            (unsigned long)hoxml_buffer_length, (unsigned long)hoxml_buffer_length * 2);
-                        hoxml_buffer_length *= 2;
-                        new_buffer = malloc(hoxml_buffer_length);
-                        hoxml_realloc(&hoxml_context, new_buffer, hoxml_buffer_length);
-                        free(hoxml_buffer);
-                        hoxml_buffer = new_buffer;
-                    } else { /* NOT a recoverable error */
-                        /* Some of the test documents are invalid and errors are expected. For them, just continue to */
-                        /* the next document. For the rest, the valid documents, the error can't go ignored. */
-                        if (document_index < NUM_INVALID_DOCUMENTS) { /* The document was invalid, this is expected */
-                            printf("  --- Document \"%s\" returned error code %d on line %u, column %u as expected. "
-                                "Pass.\n", documents[document_index], code, hoxml_context.line, hoxml_context.column);
-                            is_done_with_document = 1;
-                            break;
-                        } else { /* The document was valid and something is wrong */
-                            fprintf(stderr, "\n\n Error on line %d, column %d: %d\n", hoxml_context.line,
-                                hoxml_context.column, code);
-                            fclose(file);
-                            free(hoxml_buffer);
-                            return EXIT_FAILURE;
-                        }
-                    }
-                } else if (code == HOXML_END_OF_DOCUMENT) {
-                    /* Hopefully, this is one of the valid documents where we expect to eventually receive this code. */
-                    /* But if this is not one of those documents, the test has failed. */
-                    if (document_index < NUM_INVALID_DOCUMENTS) { /* The document was invalid, an error was expected */
-                        fprintf(stderr, "\n\n  Parsing of document \"%s\" completed successfully but was expected to "
-                            "fail\n", documents[document_index]);
-                        return EXIT_FAILURE;
-                    } else { /* The document was valid and parsed to the end of it so we're done with it */
-                        printf("  --- Parsing of document %s completed without error. Pass.\n",
-                            documents[document_index]);
-                        is_done_with_document = 1;
-                        break;
-                    }
-                } else {
-                    switch (code) {
-                    case HOXML_ELEMENT_BEGIN:
-                        printf("  element  begin: \"%s\"\n", hoxml_context.tag);
-                        break;
-                    case HOXML_ELEMENT_END:
-                        printf("  element    end: \"%s\"\n", hoxml_context.tag);
-                        if (hoxml_context.content != NULL) {
-                            int is_empty;
-                            char* iterator;
-
-                            /* Check the content to see if it only contains whitespace */
-                            is_empty = 1;
-                            iterator = hoxml_context.content;
-                            while (*iterator != 0) {
-                                if (!HOXML_IS_WHITESPACE(*iterator)) {
-                                    is_empty = 0;
-                                    break;
-                                }
-                                iterator++;
-                            }
-                            /* If the content string contains more than just whitespace */
-                            if (is_empty == 0)
-                                printf("         content: \"%s\"\n", hoxml_context.content);
-                        }
-                        break;
-                    case HOXML_ATTRIBUTE:
-                        printf("  attribute name: \"%s\"\n", hoxml_context.attribute);
-                        printf("           value: \"%s\"\n", hoxml_context.value);
-                        printf("      of element: \"%s\"\n", hoxml_context.tag);
-                        break;
-                    case HOXML_PROCESSING_INSTRUCTION_BEGIN:
-                        printf("  PI      target: \"%s\"\n", hoxml_context.tag);
-                        break;
-                    case HOXML_PROCESSING_INSTRUCTION_END:
-                        printf("  PI     content: \"%s\"\n", hoxml_context.content);
-                        break;
-                    default: break;
-                    }
-                }
+            if (!is_valid && (mode->flags & MODE_VALID_ONLY))
+                continue;
+            memset(&transcript, 0, sizeof(transcript));
+            append_str(&transcript, "");
+            mode->parse(documents[document_index], mode, &transcript);
+            if (mode_index == 0)
+                printf("%s", transcript.text);
+            if (compare_transcripts(mode->flags & MODE_TWICE ? twice : expected, transcript.text, mode->flags)) {
+                printf("  --- Parsing of document %s %s found the expected codes. Pass.\n",
+                    documents[document_index], mode->name);
+            } else {
+                fprintf(stderr, "\n\n  Parsing of document \"%s\" %s did not find the expected codes\n",
+                    documents[document_index], mode->name);
+                failure_count++;
             }
-
-            if (is_done_with_document == 1)
-                break;
+            free(transcript.text);
+            free(transcript.content);
         }
+        free(twice);
+        free(expected);
+    }
 
-        fclose(file);
-        free(hoxml_buffer);
+    /* These check what's done with the codes rather than the codes themselves */
+    if (from == 0 && to == NUM_DOCUMENTS - 1) {
+        if (test_skipping())
+            printf("  --- Skipping elements found the expected codes. Pass.\n");
+        else {
+            fprintf(stderr, "\n\n  Skipping elements did not find the expected codes\n");
+            failure_count++;
+        }
+        if (test_binding(0) && test_binding(HOXML_OPTION_VIEWS))
+            printf("  --- Binding attributes stored the expected values. Pass.\n");
+        else {
+            fprintf(stderr, "\n\n  Binding attributes did not store the expected values\n");
+            failure_count++;
+        }
+        if (test_conversions(0) && test_conversions(HOXML_OPTION_VIEWS))
+            printf("  --- Converting values and content found the expected numbers. Pass.\n");
+        else {
+            fprintf(stderr, "\n\n  Converting values and content did not find the expected numbers\n");
+            failure_count++;
+        }
+        if (test_decoding())
+            printf("  --- Decoding data found the expected integers. Pass.\n");
+        else {
+            fprintf(stderr, "\n\n  Decoding data did not find the expected integers\n");
+            failure_count++;
+        }
     }
 
+    if (failure_count > 0) {
+        fprintf(stderr, "\n\n\n  FAIL (%d)\n", failure_count);
+        return EXIT_FAILURE;
+    }
     printf("\n\n\n  PASS\n");
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}